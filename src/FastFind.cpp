@@ -1,7 +1,11 @@
 #include <vector>
 #include <string>
 #include <cmath>
-#include "cppHeader.hpp"
+#include <memory>
+#include <algorithm>
+#include <map>
+#include <limits>
+#include "FastFind.hpp"
 #include <Eigen/Dense>
 
 /**
@@ -9,77 +13,299 @@
  * @brief Implements fast pattern recognition for financial chart patterns
  * 
  * This file provides implementation for detecting chart patterns in financial time series data.
- * Currently supports Shoulder-Head-Shoulder (SHS) and inverse Shoulder-Head-Shoulder (iSHS) patterns.
+ * Currently supports Shoulder-Head-Shoulder (SHS), inverse Shoulder-Head-Shoulder (iSHS),
+ * double top/bottom (DTOP/DBOT), triple top/bottom (TTOP/TBOT), broadening
+ * top/bottom (BTOP/BBOT), triangle
+ * (ATRI/DTRI/STRI, see FastFind_Triangles.cpp), wedge (RWEDGE/FWEDGE, see
+ * FastFind_Wedges.cpp), rectangle (RTOP/RBOT, see
+ * FastFind_Rectangles.cpp), flag/pennant (BULLF/BEARF/BULLP/BEARP, see
+ * FastFind_Flags.cpp), cup-and-handle (CUPH, see FastFind_Cups.cpp) patterns and
+ * trendline breaks (SUPB/RESB, see FastFind_TrendlineBreaks.cpp).
  * The implementation uses preprocessed pivot points to efficiently identify potential patterns.
  */
 
 // Forward declarations
 double linearInterpolation(double x1, double x2, double y1, double y2, double x);
 bool isValidIndex(int idx, int maxSize);
-bool detectPattern(const NumericVector& prices, const NumericVector& times, int i, 
-                  bool isInverted, double& leftNecklineValue, double& rightNecklineValue, 
-                  double& firstPointNecklineValue);
-void calculateReturns(const NumericVector& prices, const NumericVector& times,
-                     int breakoutIdx, int patternStartIdx, std::vector<double>& returns,
-                     std::vector<double>& relReturns);
+int toRIndex(int idx);
+Eigen::ArrayXd shsConfidence(const SeriesData& series, bool isInverted);
+Rcpp::DataFrame patternGeometry(const std::vector<PatternData>& patterns);
+std::vector<PatternData> strongestPatterns(const SeriesData& series,
+                                           const std::vector<PatternData>& patterns);
+double formationQuality(const SeriesData& series, const RollingVolatility& volatility,
+                        const PatternData& pattern);
+double breakoutStrength(const SeriesData& series, const RollingVolatility& volatility,
+                        const PatternData& pattern);
+bool detectDoubleExtreme(const PipWindow& window, bool isInverted, double tolerance);
+bool detectTripleExtreme(const PipWindow& window, bool isInverted, double tolerance);
+bool detectBroadening(const PipWindow& window, bool isInverted);
 
 // Constants for optimization
 const int EXPECTED_PATTERN_COUNT = 100;  // Reasonable guess for pre-allocation
-const double MIN_HEAD_SHOULDER_DIFF = 0.01; // Minimum price difference to consider a valid head-shoulder pattern
 const int MAX_LOOK_AHEAD = 60; // Maximum periods to check for return calculations
 
-// Constants like 99999991 appear in the code
-const int INVALID_TIME = 99999991;
+class SHSDetector : public PatternDetector {
+public:
+    explicit SHSDetector(double tolerance) : tolerance(tolerance) {}
+    
+    void prepare(const SeriesData& series) override {
+        confidence = shsConfidence(series, false);
+    }
+    
+    bool detect(const SeriesData& /*series*/, const PipWindow& window,
+                PatternData& outPattern) const override {
+        // All rule margins have to exceed the tolerance
+        if (!(confidence[window.i] > tolerance)) {
+            return false;
+        }
+        setPatternPoints(window, 6, outPattern);
+        outPattern.patternName = getName();
+        outPattern.confidence  = confidence[window.i];
+        // Breakout below the neckline, invalid above the right shoulder
+        setBreakoutLine(window.t[2], window.p[2], window.t[4], window.p[4], window.p[5], true, outPattern);
+        return true;
+    }
+    
+    std::string getName() const override {
+        return "SHS";
+    }
+    
+private:
+    double tolerance;
+    Eigen::ArrayXd confidence;
+};
 
-// Define a common interface for all pattern detectors
-class PatternDetector {
+class ISHSDetector : public PatternDetector {
 public:
-    virtual ~PatternDetector() = default;
-    
-    // Returns true if a pattern is detected at the given position
-    virtual bool detect(const NumericVector& prices, const NumericVector& times, 
-                        int position, PatternData& outPattern) const = 0;
-    
-    // Each detector knows how to check for its breakout condition
-    virtual bool detectBreakout(const NumericVector& prices, const NumericVector& times,
-                               int j, const PatternData& pattern) const = 0;
-                               
-    // Get the name of this pattern
-    virtual std::string getName() const = 0;
+    explicit ISHSDetector(double tolerance) : tolerance(tolerance) {}
+    
+    void prepare(const SeriesData& series) override {
+        confidence = shsConfidence(series, true);
+    }
+    
+    bool detect(const SeriesData& /*series*/, const PipWindow& window,
+                PatternData& outPattern) const override {
+        if (!(confidence[window.i] > tolerance)) {
+            return false;
+        }
+        setPatternPoints(window, 6, outPattern);
+        outPattern.patternName = getName();
+        outPattern.confidence  = confidence[window.i];
+        // Breakout above the neckline, invalid below the right shoulder
+        setBreakoutLine(window.t[2], window.p[2], window.t[4], window.p[4], window.p[5], false, outPattern);
+        return true;
+    }
+    
+    std::string getName() const override {
+        return "iSHS";
+    }
+    
+private:
+    double tolerance;
+    Eigen::ArrayXd confidence;
 };
 
-class SHSDetector : public PatternDetector {
+// Double top on the points 0..3 of the window: low, top, trough, top
+class DoubleTopDetector : public PatternDetector {
 public:
-    bool detect(const NumericVector& prices, const NumericVector& times, 
-                int position, PatternData& outPattern) const override {
-        // SHS-specific detection logic
-        // ...
-        return patternDetected;
+    explicit DoubleTopDetector(double tolerance) : tolerance(tolerance) {}
+    
+    int windowLength() const override {
+        return 4;
     }
     
-    bool detectBreakout(const NumericVector& prices, const NumericVector& times,
-                       int j, const PatternData& pattern) const override {
-        // SHS-specific breakout detection
-        // ...
-        return breakoutDetected;
+    bool detect(const SeriesData& /*series*/, const PipWindow& window,
+                PatternData& outPattern) const override {
+        if (!detectDoubleExtreme(window, false, tolerance)) {
+            return false;
+        }
+        setPatternPoints(window, 4, outPattern);
+        outPattern.patternName = getName();
+        // Breakout below the trough, invalid above the second top
+        setBreakoutLine(window.t[2], window.p[2], window.t[3], window.p[2], window.p[3], true, outPattern);
+        return true;
     }
     
     std::string getName() const override {
-        return "SHS";
+        return "DTOP";
     }
+    
+private:
+    double tolerance;
 };
 
-class ISHSDetector : public PatternDetector {
-    // Similar implementation for inverse SHS pattern
+// Double bottom on the points 0..3 of the window: high, bottom, peak, bottom
+class DoubleBottomDetector : public PatternDetector {
+public:
+    explicit DoubleBottomDetector(double tolerance) : tolerance(tolerance) {}
+    
+    int windowLength() const override {
+        return 4;
+    }
+    
+    bool detect(const SeriesData& /*series*/, const PipWindow& window,
+                PatternData& outPattern) const override {
+        if (!detectDoubleExtreme(window, true, tolerance)) {
+            return false;
+        }
+        setPatternPoints(window, 4, outPattern);
+        outPattern.patternName = getName();
+        // Breakout above the peak, invalid below the second bottom
+        setBreakoutLine(window.t[2], window.p[2], window.t[3], window.p[2], window.p[3], false, outPattern);
+        return true;
+    }
+    
+    std::string getName() const override {
+        return "DBOT";
+    }
+    
+private:
+    double tolerance;
+};
+
+// Triple top on the same points as SHS: low, top, trough, top, trough, top
+class TripleTopDetector : public PatternDetector {
+public:
+    explicit TripleTopDetector(double tolerance) : tolerance(tolerance) {}
+    
+    bool detect(const SeriesData& /*series*/, const PipWindow& window,
+                PatternData& outPattern) const override {
+        if (!detectTripleExtreme(window, false, tolerance)) {
+            return false;
+        }
+        setPatternPoints(window, 6, outPattern);
+        outPattern.patternName = getName();
+        // Breakout below the support line through the troughs, invalid above the third top
+        setBreakoutLine(window.t[2], window.p[2], window.t[4], window.p[4], window.p[5], true, outPattern);
+        return true;
+    }
+    
+    std::string getName() const override {
+        return "TTOP";
+    }
+    
+private:
+    double tolerance;
+};
+
+// Triple bottom: high, bottom, peak, bottom, peak, bottom
+class TripleBottomDetector : public PatternDetector {
+public:
+    explicit TripleBottomDetector(double tolerance) : tolerance(tolerance) {}
+    
+    bool detect(const SeriesData& /*series*/, const PipWindow& window,
+                PatternData& outPattern) const override {
+        if (!detectTripleExtreme(window, true, tolerance)) {
+            return false;
+        }
+        setPatternPoints(window, 6, outPattern);
+        outPattern.patternName = getName();
+        // Breakout above the resistance line through the peaks, invalid below the third bottom
+        setBreakoutLine(window.t[2], window.p[2], window.t[4], window.p[4], window.p[5], false, outPattern);
+        return true;
+    }
+    
+    std::string getName() const override {
+        return "TBOT";
+    }
+    
+private:
+    double tolerance;
 };
 
+// Broadening top: low, then higher highs and lower lows on the points 1..5
+class BroadeningTopDetector : public PatternDetector {
+public:
+    bool detect(const SeriesData& /*series*/, const PipWindow& window,
+                PatternData& outPattern) const override {
+        if (!detectBroadening(window, false)) {
+            return false;
+        }
+        setPatternPoints(window, 6, outPattern);
+        outPattern.patternName = getName();
+        // Breakout below the line through the falling lows, invalid above the last high
+        setBreakoutLine(window.t[2], window.p[2], window.t[4], window.p[4], window.p[5], true, outPattern);
+        return true;
+    }
+    
+    std::string getName() const override {
+        return "BTOP";
+    }
+};
+
+// Broadening bottom: high, then lower lows and higher highs on the points 1..5
+class BroadeningBottomDetector : public PatternDetector {
+public:
+    bool detect(const SeriesData& /*series*/, const PipWindow& window,
+                PatternData& outPattern) const override {
+        if (!detectBroadening(window, true)) {
+            return false;
+        }
+        setPatternPoints(window, 6, outPattern);
+        outPattern.patternName = getName();
+        // Breakout above the line through the rising highs, invalid below the last low
+        setBreakoutLine(window.t[2], window.p[2], window.t[4], window.p[4], window.p[5], false, outPattern);
+        return true;
+    }
+    
+    std::string getName() const override {
+        return "BBOT";
+    }
+};
+
+// Detector that reports the pattern with the given name, nullptr for unknown names.
+// Used to verify single windows outside the fastFind loop
+std::unique_ptr<PatternDetector> createDetector(const std::string& patternName,
+                                                double peakTolerance, double lineTolerance) {
+  auto is = [&](std::initializer_list<const char*> names) {
+    return std::find(names.begin(), names.end(), patternName) != names.end();
+  };
+
+  if (is({"SHS"})) {
+    return std::make_unique<SHSDetector>(0.0);
+  } else if (is({"iSHS"})) {
+    return std::make_unique<ISHSDetector>(0.0);
+  } else if (is({"DTOP"})) {
+    return std::make_unique<DoubleTopDetector>(peakTolerance);
+  } else if (is({"DBOT"})) {
+    return std::make_unique<DoubleBottomDetector>(peakTolerance);
+  } else if (is({"TTOP"})) {
+    return std::make_unique<TripleTopDetector>(peakTolerance);
+  } else if (is({"TBOT"})) {
+    return std::make_unique<TripleBottomDetector>(peakTolerance);
+  } else if (is({"BTOP"})) {
+    return std::make_unique<BroadeningTopDetector>();
+  } else if (is({"BBOT"})) {
+    return std::make_unique<BroadeningBottomDetector>();
+  } else if (is({"ATRI", "DTRI", "STRI"})) {
+    return std::make_unique<TriangleDetector>(lineTolerance);
+  } else if (is({"RWEDGE", "FWEDGE"})) {
+    return std::make_unique<WedgeDetector>(lineTolerance);
+  } else if (is({"RTOP", "RBOT"})) {
+    return std::make_unique<RectangleDetector>(lineTolerance);
+  } else if (is({"BULLF", "BEARF", "BULLP", "BEARP"})) {
+    return std::make_unique<FlagDetector>(lineTolerance);
+  } else if (is({"CUPH"})) {
+    return std::make_unique<CupDetector>(peakTolerance);
+  }
+  return nullptr;
+}
+
 //' @name fastFind
  //' @title fastFind Patterns
 //' @description The pattern recognition is done for all patterns in one loop. The single functions loop per pattern over the dataset
  //' @param prices Vector with prices
 //' @param time Vector with time or indices
+//' @param peakTolerance Maximum relative difference of the extremes of a double or triple top/bottom and of the rims of a cup
+//' @param lineTolerance Maximum residual of a trendline fit, maximum move of a flat trendline and width of the rectangle bands, relative to the price
+//' @param maxGap Number of minor swings (PIP pairs) a SHS/iSHS may skip between two of its points, e.g. inside a shoulder. 0 checks consecutive PIPs only
+//' @param shsTolerance Lowest accepted margin of the SHS/iSHS rules in units of the local volatility. Negative values accept near-misses, 0 applies the rules strictly, with and without maxGap
+//' @param nonMaxSuppression If TRUE, only the best of overlapping instances of a pattern is reported (see suppressOverlaps), scored by confidence or else by the relative height of the pattern points. patternCounts still counts all instances
+//' @param minQuality Lowest accepted formation quality (column quality, between 0 and 1). Formations below it are counted as candidates but skip the breakout search and the returns. 0 keeps all
+//' @param sessions Optional session number of every price (non-decreasing, e.g. a running count of trading days, or seq_along(prices) for bars). Return horizons are then counted in sessions, each measured at the close of the target session, so days without observations do not distort them. NULL measures the horizons in calendar differences of Original_times
  //' @param mask with PIPs in the price-time vectors
  //' @return Returns First the index where a pattern is located
+//' @details The list element patternCounts holds per pattern the number of detected formations and of valid breakouts. The column confidence of patternInfo is the smallest SHS/iSHS rule margin in volatility units (NA for other patterns). Geometry holds per pattern the slopes (getSlope) and durations of the segments between the pattern points, the shoulder symmetry ratios (left to right duration and height over the neckline), the head prominence above the higher shoulder relative to the head height over the neckline and the neckline slope. Values of points a pattern does not have are NA. The column quality of patternInfo scores the formation when it is detected, as the mean of the shoulder symmetry (durations and heights over the neckline), the height of the pattern points and the flatness of the breakout line, the latter two relative to the local volatility. Patterns other than SHS/iSHS get 0.5 for the symmetry, as do patterns with less than two points after the start for the height, so quality and minQuality are on one scale for all patterns. breakoutStrength is the distance of the breakout price beyond the breakout line in volatility units
  //' @examples
  //' c(1:10)
  //'
@@ -87,7 +313,14 @@ class ISHSDetector : public PatternDetector {
  // [[Rcpp::export]]
  Rcpp::DataFrame fastFind(IntegerVector PrePro_indexFilter,
                           NumericVector Original_times,
-                          NumericVector Original_prices
+                          NumericVector Original_prices,
+                          double peakTolerance = 0.015,
+                          double lineTolerance = 0.02,
+                          int maxGap = 0,
+                          double shsTolerance = 0.0,
+                          Rcpp::Nullable<IntegerVector> sessions = R_NilValue,
+                          bool nonMaxSuppression = false,
+                          double minQuality = 0.0
  ){
    
   // Controls whether the index starts at zero
@@ -100,61 +333,217 @@ class ISHSDetector : public PatternDetector {
    NumericVector QuerySeries_times  = Original_times[PrePro_indexFilter];
    NumericVector QuerySeries_prices = Original_prices[PrePro_indexFilter];
    
-  // Create a struct to hold pattern data
-  struct PatternData {
-    int startIdx, leftShoulderIdx, necklineStartIdx, headIdx, necklineEndIdx, rightShoulderIdx, breakoutIdx;
-    std::string patternName;
-    std::vector<int> timeStamps;
-    std::vector<double> priceStamps;
-    double trendBeginPrice;
-    int trendBeginTime;
-    double trendEndPrice;
-    int trendEndTime;
-    std::vector<double> returns;       // Fixed time window returns
-    std::vector<double> relReturns;    // Relative time window returns
-  };
-  
-  // Use a vector of this struct instead of separate vectors
+  // Use a vector of PatternData instead of separate vectors
   std::vector<PatternData> patterns;
   
   // Pre-allocate with a reasonable capacity to reduce reallocations
   patterns.reserve(EXPECTED_PATTERN_COUNT);
   
-  // Main loop through data to find patterns
-  // We need at least 6 points for pattern detection, thus -6 in the loop condition
+  SeriesData series = {PrePro_indexFilter, Original_times, Original_prices,
+                       QuerySeries_times, QuerySeries_prices};
+  
+  // Return horizons in sessions (bars) instead of calendar time
+  SessionIndex sessionIndex;
+  if(sessions.isNotNull()) {
+    IntegerVector sessionNumbers(sessions.get());
+    if(sessionNumbers.size() != Original_prices.size()) {
+      stop("sessions needs one session number per price.");
+    }
+    for(int j = 0; j < sessionNumbers.size(); ++j) {
+      if(sessionNumbers[j] == NA_INTEGER || (j > 0 && sessionNumbers[j] < sessionNumbers[j-1])) {
+        stop("sessions must not be NA or decreasing.");
+      }
+    }
+    sessionIndex = SessionIndex(sessionNumbers);
+  }
+  
   std::vector<std::unique_ptr<PatternDetector>> detectors;
-  detectors.push_back(std::make_unique<SHSDetector>());
-  detectors.push_back(std::make_unique<ISHSDetector>());
+  if(maxGap > 0) {
+    // Subsequences of PIPs, the consecutive matches included
+    detectors.push_back(std::make_unique<GappedSHSDetector>(maxGap, shsTolerance));
+  } else {
+    detectors.push_back(std::make_unique<SHSDetector>(shsTolerance));
+    detectors.push_back(std::make_unique<ISHSDetector>(shsTolerance));
+  }
+  detectors.push_back(std::make_unique<DoubleTopDetector>(peakTolerance));
+  detectors.push_back(std::make_unique<DoubleBottomDetector>(peakTolerance));
+  detectors.push_back(std::make_unique<TripleTopDetector>(peakTolerance));
+  detectors.push_back(std::make_unique<TripleBottomDetector>(peakTolerance));
+  detectors.push_back(std::make_unique<BroadeningTopDetector>());
+  detectors.push_back(std::make_unique<BroadeningBottomDetector>());
+  detectors.push_back(std::make_unique<TriangleDetector>(lineTolerance));
+  detectors.push_back(std::make_unique<WedgeDetector>(lineTolerance));
+  detectors.push_back(std::make_unique<RectangleDetector>(lineTolerance));
+  detectors.push_back(std::make_unique<FlagDetector>(lineTolerance));
+  detectors.push_back(std::make_unique<CupDetector>(peakTolerance));
+  detectors.push_back(std::make_unique<TrendlineBreakDetector>());
   // Add more detectors as needed
   
-  for(int i=0; i < (QuerySeries_prices.size() - 6); ++i){
-    
-    // Add early rejection conditions before the expensive pattern checks
-    if (abs(QuerySeries_prices[i+3] - QuerySeries_prices[i+1]) < MIN_HEAD_SHOULDER_DIFF ||
-        abs(QuerySeries_prices[i+3] - QuerySeries_prices[i+5]) < MIN_HEAD_SHOULDER_DIFF) {
-        continue; // Skip if head isn't significantly different from shoulders
-    }
-    
-    // Pre-calculate neckline values (reused for both pattern types)
-    double leftShoulderNecklineValue = 0;
-    double rightShoulderNecklineValue = 0;
-    double firstPointNecklineValue = 0;
-    
-    bool isInverted = false; // Start with SHS
-    for (int attempt = 0; attempt < 2; attempt++) {
-        for(const auto& detector : detectors) {
-            PatternData pattern;
-            if(detector->detect(QuerySeries_prices, QuerySeries_times, i, pattern)) {
-                // Process detected pattern...
-                // Breakout detection logic using detector->detectBreakout()
-                // ...
-                patterns.push_back(pattern);
-            }
-        }
-        isInverted = true; // Try iSHS on second attempt
+  for(const auto& detector : detectors) {
+    detector->prepare(series);
+  }
+  
+  // The shortest window decides how far the loop runs
+  int minWindowLength = WINDOW_SIZE;
+  for(const auto& detector : detectors) {
+    minWindowLength = std::min(minWindowLength, detector->windowLength());
+  }
+  
+  // Per pattern: detected formations and formations with a valid breakout
+  std::map<std::string, PatternCount> counts;
+  
+  // Local volatility the quality scores are measured in
+  RollingVolatility volatility(Original_prices);
+  
+  // Main loop through data to find patterns
+  // SHS needs 7 points for pattern detection, shorter formations run until the end of the series
+  PipWindow window;
+  for(int i=0; i <= (QuerySeries_prices.size() - minWindowLength); ++i){
+    
+    // The window (and its neckline) is loaded once and shared by all detectors
+    loadWindow(series, i, window);
+    
+    for(const auto& detector : detectors) {
+      PatternData pattern;
+      if(window.size < detector->windowLength() ||
+         !detector->detect(series, window, pattern)) {
+        continue;
+      }
+      PatternCount& count = counts[pattern.patternName];
+      ++count.candidates;
+      // Scored while the window is at hand, weak formations skip the breakout and returns
+      pattern.quality = formationQuality(series, volatility, pattern);
+      if(pattern.quality < minQuality) {
+        continue;
+      }
+      if(!findBreakout(*detector, series, pattern)) {
+        continue;
+      }
+      pattern.breakoutStrength = breakoutStrength(series, volatility, pattern);
+      ++count.breakouts;
+      patterns.push_back(pattern);
     }
   }
   
+  if(nonMaxSuppression) {
+    patterns = strongestPatterns(series, patterns);
+  }
+  
+  for(PatternData& pattern : patterns) {
+    calculateTrend(series, pattern);
+    // Returns are measured from the buy price after the breakout
+    calculateReturns(Original_prices, Original_times, pattern.breakoutIdx + 1,
+                     PrePro_indexFilter[pattern.startIdx], pattern.returns, pattern.relReturns,
+                     sessions.isNotNull() ? &sessionIndex : nullptr);
+  }
+  
+  return patternResults(patterns, counts);
+}
+
+// Implementation of helper functions
+
+// Non-maximum suppression of the detected patterns: per pattern the best of overlapping
+// spans (first to last pattern point) survives. The score is the rule confidence where
+// the detector has one, otherwise the height of the pattern points relative to the start
+std::vector<PatternData> strongestPatterns(const SeriesData& series,
+                                           const std::vector<PatternData>& patterns) {
+  std::vector<std::string> names;
+  std::vector<double> starts, ends, scores;
+  for(const auto& pattern : patterns) {
+    names.push_back(pattern.patternName);
+    starts.push_back(series.indexFilter[pattern.startIdx]);
+    ends.push_back(series.indexFilter[pattern.lastPointIdx]);
+    if(!std::isnan(pattern.confidence)) {
+      scores.push_back(pattern.confidence);
+    } else {
+      double low  = series.pipPrices[pattern.startIdx];
+      double high = low;
+      for(int j = pattern.startIdx; j <= pattern.lastPointIdx; ++j) {
+        low  = std::min(low,  (double)series.pipPrices[j]);
+        high = std::max(high, (double)series.pipPrices[j]);
+      }
+      scores.push_back((high - low) / std::fabs(series.pipPrices[pattern.startIdx]));
+    }
+  }
+  
+  std::vector<bool> keep = overlapWinners(names, starts, ends, scores);
+  std::vector<PatternData> strongest;
+  for(size_t i = 0; i < patterns.size(); ++i) {
+    if(keep[i]) {
+      strongest.push_back(patterns[i]);
+    }
+  }
+  return strongest;
+}
+
+// Neutral value of a quality component a pattern does not have
+const double NEUTRAL_QUALITY = 0.5;
+
+// Quality of a detected formation in [0, 1]: the mean of the shoulder symmetry, the height of
+// the pattern points after the start point and the flatness of the breakout line. Heights and
+// line moves are taken relative to the local volatility at the last pattern point and mapped
+// to [0, 1], so the components weigh alike. Patterns without shoulders (all but SHS/iSHS) or
+// without two points after the start get the neutral value for that component, so every
+// pattern is scored on the same scale
+double formationQuality(const SeriesData& series, const RollingVolatility& volatility,
+                        const PatternData& pattern) {
+  const std::vector<double>& p = pattern.priceStamps;
+  const std::vector<int>& t    = pattern.timeStamps;
+  double sigma = std::max(volatility.at(series.indexFilter[pattern.lastPointIdx]),
+                          std::numeric_limits<double>::min());
+  
+  // Shoulders: durations to the head and heights over the neckline, the shorter over the longer
+  double symmetry = NEUTRAL_QUALITY;
+  if(pattern.patternName == "SHS" || pattern.patternName == "iSHS") {
+    double slope = (p[4] - p[2]) / (t[4] - t[2]);
+    double left  = std::fabs(p[1] - (p[2] + slope * (t[1] - t[2])));
+    double right = std::fabs(p[5] - (p[2] + slope * (t[5] - t[2])));
+    double leftDuration  = t[3] - t[1];
+    double rightDuration = t[5] - t[3];
+    if(std::max(left, right) > 0 && std::max(leftDuration, rightDuration) > 0) {
+      symmetry = (std::min(left, right) / std::max(left, right) +
+                  std::min(leftDuration, rightDuration) / std::max(leftDuration, rightDuration)) / 2;
+    }
+  }
+  
+  // Height of the formation: 0 for a flat one, towards 1 far above the noise
+  double height = NEUTRAL_QUALITY;
+  double low = HUGE_VAL, high = -HUGE_VAL;
+  int points = 0;
+  for(int k = 1; k < 6; ++k) {
+    if(!std::isnan(p[k])) {
+      low  = std::min(low,  p[k]);
+      high = std::max(high, p[k]);
+      ++points;
+    }
+  }
+  if(points > 1) {
+    height = (high - low) / (high - low + sigma);
+  }
+  
+  // Flat necklines and lines: 1 for a horizontal one, towards 0 for a steep one
+  double move = std::fabs(pattern.lineY2 - pattern.lineY1);
+  double flatness = sigma / (sigma + move);
+  
+  return (symmetry + height + flatness) / 3;
+}
+
+// Distance of the breakout price beyond the breakout line in units of the local volatility
+double breakoutStrength(const SeriesData& series, const RollingVolatility& volatility,
+                        const PatternData& pattern) {
+  int j = pattern.breakoutIdx;
+  double line = linearInterpolation(pattern.lineX1, pattern.lineX2,
+                                    pattern.lineY1, pattern.lineY2,
+                                    series.times[j]);
+  double distance = pattern.bearish ? line - series.prices[j] : series.prices[j] - line;
+  return distance / std::max(volatility.at(j), std::numeric_limits<double>::min());
+}
+
+// Columnar result of fastFind: patternInfo, Features2, Features21to40, Geometry and patternCounts.
+// Shared by all functions that report patterns in this format
+Rcpp::List patternResults(const std::vector<PatternData>& patterns,
+                          const std::map<std::string, PatternCount>& counts) {
+  
   // Now convert the pattern data back to the format expected by R
   // Extract data from patterns to create the flat vectors
   std::vector<std::string> PatternName;
@@ -165,6 +554,9 @@ class ISHSDetector : public PatternDetector {
   std::vector<int> necklineEndIdx;
   std::vector<int> rightShoulderIdx;
   std::vector<int> breakoutIdx;
+  std::vector<double> confidence;
+  std::vector<double> quality;
+  std::vector<double> strength;
   
   std::vector<int> timeStamp0, timeStamp1, timeStamp2, timeStamp3, timeStamp4, timeStamp5, timeStampBreakOut;
   std::vector<double> priceStamp0, priceStamp1, priceStamp2, priceStamp3, priceStamp4, priceStamp5, priceStampBreakOut;
@@ -187,6 +579,9 @@ class ISHSDetector : public PatternDetector {
   necklineEndIdx.reserve(patternCount);
   rightShoulderIdx.reserve(patternCount);
   breakoutIdx.reserve(patternCount);
+  confidence.reserve(patternCount);
+  quality.reserve(patternCount);
+  strength.reserve(patternCount);
   
   timeStamp0.reserve(patternCount);
   timeStamp1.reserve(patternCount);
@@ -225,13 +620,17 @@ class ISHSDetector : public PatternDetector {
   // Extract data from each pattern
   for(const auto& pattern : patterns) {
     PatternName.push_back(pattern.patternName);
-    startIdx.push_back(pattern.startIdx);
-    leftShoulderIdx.push_back(pattern.leftShoulderIdx);
-    necklineStartIdx.push_back(pattern.necklineStartIdx);
-    headIdx.push_back(pattern.headIdx);
-    necklineEndIdx.push_back(pattern.necklineEndIdx);
-    rightShoulderIdx.push_back(pattern.rightShoulderIdx);
-    breakoutIdx.push_back(pattern.breakoutIdx);
+    // WE NEED TO ADD 1 BECAUSE R INDICES START AT 1 NOT 0 (like in C++)
+    startIdx.push_back(toRIndex(pattern.startIdx));
+    leftShoulderIdx.push_back(toRIndex(pattern.leftShoulderIdx));
+    necklineStartIdx.push_back(toRIndex(pattern.necklineStartIdx));
+    headIdx.push_back(toRIndex(pattern.headIdx));
+    necklineEndIdx.push_back(toRIndex(pattern.necklineEndIdx));
+    rightShoulderIdx.push_back(toRIndex(pattern.rightShoulderIdx));
+    breakoutIdx.push_back(toRIndex(pattern.breakoutIdx));
+    confidence.push_back(pattern.confidence);
+    quality.push_back(pattern.quality);
+    strength.push_back(pattern.breakoutStrength);
     
     // Time stamps
     timeStamp0.push_back(pattern.timeStamps[0]);
@@ -284,6 +683,9 @@ class ISHSDetector : public PatternDetector {
                                                          Rcpp::Named("necklineEndIdx")      = necklineEndIdx,
                                                          Rcpp::Named("rightShoulderIdx")      = rightShoulderIdx,
                                                          Rcpp::Named("breakoutIdx")      = breakoutIdx,
+                                                         Rcpp::Named("confidence")       = confidence,
+                                                         Rcpp::Named("quality")          = quality,
+                                                         Rcpp::Named("breakoutStrength") = strength,
                                                          Rcpp::Named("TrendBeginnPreis")         = TrendBeginnPreis,
                                                          Rcpp::Named("TrendBeginnZeit")          = TrendBeginnZeit,
                                                          Rcpp::Named("TrendEndePreis")           = TrendEndePreis,
@@ -321,64 +723,395 @@ class ISHSDetector : public PatternDetector {
      Rcpp::Named("relRendite4V")  = relRendite4V
    );
    
+   std::vector<std::string> countName;
+   std::vector<int> countCandidates, countBreakouts;
+   for(const auto& count : counts) {
+     countName.push_back(count.first);
+     countCandidates.push_back(count.second.candidates);
+     countBreakouts.push_back(count.second.breakouts);
+   }
+   
+   Rcpp::DataFrame patternCounts = Rcpp::DataFrame::create(
+     Rcpp::Named("PatternName") = countName,
+     Rcpp::Named("candidates")  = countCandidates,
+     Rcpp::Named("breakouts")   = countBreakouts
+   );
+   
   // Return a list containing all the data frames with pattern information
   return Rcpp::List::create(
     Rcpp::Named("patternInfo")     = patternInfo,
                              Rcpp::Named("Features2")       = Features2,
-                             Rcpp::Named("Features21to40")  = Features21to41
+                             Rcpp::Named("Features21to40")  = Features21to41,
+                             Rcpp::Named("Geometry")        = patternGeometry(patterns),
+                             Rcpp::Named("patternCounts")   = patternCounts
    );
 }
 
-// Implementation of helper functions
 
 // Efficient boundary checking
 inline bool isValidIndex(int idx, int maxSize) {
   return (idx >= 0 && idx < maxSize);
 }
 
-// Generic pattern detection for both SHS and iSHS
-bool detectPattern(const NumericVector& prices, const NumericVector& times, int i, 
-                 bool isInverted, double& leftNecklineValue, double& rightNecklineValue, 
-                 double& firstPointNecklineValue) {
+// R indices start at 1, unused pattern points (-1) become NA
+inline int toRIndex(int idx) {
+  return idx < 0 ? NA_INTEGER : idx + 1;
+}
+
+// Loads the PIPs i..i+6 and the neckline values shared by the detectors
+void loadWindow(const SeriesData& series, int i, PipWindow& window) {
+  window.i    = i;
+  window.size = std::min(WINDOW_SIZE, (int)series.pipPrices.size() - i);
+  for (int k = 0; k < window.size; ++k) {
+    window.t[k] = series.pipTimes[i+k];
+    window.p[k] = series.pipPrices[i+k];
+  }
+  if (window.size < 6) {
+    return;
+  }
   
   // Precalculate neckline values to avoid redundant calculations
-  leftNecklineValue = linearInterpolation(times[i+2], times[i+4], 
-                                        prices[i+2], prices[i+4], 
-                                        times[i+1]);
-  
-  rightNecklineValue = linearInterpolation(times[i+2], times[i+4], 
-                                         prices[i+2], prices[i+4], 
-                                         times[i+5]);
-                                         
-  firstPointNecklineValue = linearInterpolation(times[i+2], times[i+4], 
-                                              prices[i+2], prices[i+4], 
-                                              times[i]);
+  window.leftNecklineValue = linearInterpolation(window.t[2], window.t[4],
+                                                 window.p[2], window.p[4],
+                                                 window.t[1]);
+  
+  window.rightNecklineValue = linearInterpolation(window.t[2], window.t[4],
+                                                  window.p[2], window.p[4],
+                                                  window.t[5]);
+  
+  window.firstPointNecklineValue = linearInterpolation(window.t[2], window.t[4],
+                                                       window.p[2], window.p[4],
+                                                       window.t[0]);
+}
+
+// Copies the first pointCount points of the window into the pattern
+void setPatternPoints(const PipWindow& window, int pointCount, PatternData& pattern) {
+  int* pointIdx[6] = {&pattern.startIdx, &pattern.leftShoulderIdx, &pattern.necklineStartIdx,
+                      &pattern.headIdx, &pattern.necklineEndIdx, &pattern.rightShoulderIdx};
+  
+  pattern.timeStamps.assign(WINDOW_SIZE, NA_INTEGER);
+  pattern.priceStamps.assign(WINDOW_SIZE, NA_REAL);
+  for (int k = 0; k < 6; ++k) {
+    if (k < pointCount) {
+      *pointIdx[k] = window.i + k;
+      pattern.timeStamps[k]  = window.t[k];
+      pattern.priceStamps[k] = window.p[k];
+    } else {
+      *pointIdx[k] = -1;
+    }
+  }
+  pattern.breakoutIdx  = -1;
+  pattern.lastPointIdx = window.i + pointCount - 1;
+}
+
+// Copies the given (not necessarily consecutive) PIPs into the pattern
+void setPatternPoints(const SeriesData& series, const std::vector<int>& pips, PatternData& pattern) {
+  int* pointIdx[6] = {&pattern.startIdx, &pattern.leftShoulderIdx, &pattern.necklineStartIdx,
+                      &pattern.headIdx, &pattern.necklineEndIdx, &pattern.rightShoulderIdx};
+  
+  pattern.timeStamps.assign(WINDOW_SIZE, NA_INTEGER);
+  pattern.priceStamps.assign(WINDOW_SIZE, NA_REAL);
+  for (int k = 0; k < 6; ++k) {
+    if (k < (int)pips.size()) {
+      *pointIdx[k] = pips[k];
+      pattern.timeStamps[k]  = series.pipTimes[pips[k]];
+      pattern.priceStamps[k] = series.pipPrices[pips[k]];
+    } else {
+      *pointIdx[k] = -1;
+    }
+  }
+  pattern.breakoutIdx  = -1;
+  pattern.lastPointIdx = pips.back();
+}
+
+// Stores the line whose crossing is the breakout
+void setBreakoutLine(double x1, double y1, double x2, double y2,
+                     double invalidationPrice, bool bearish, PatternData& pattern) {
+  pattern.lineX1 = x1;
+  pattern.lineY1 = y1;
+  pattern.lineX2 = x2;
+  pattern.lineY2 = y2;
+  pattern.invalidationPrice = invalidationPrice;
+  pattern.bearish = bearish;
+}
+
+// Trendline formations: start point, first and last swing point of both lines.
+// The price stamps of the swing points are the fitted line values
+void setTrendlinePoints(const SeriesData& series, int start, int firstUpper, int lastUpper,
+                        int firstLower, int lastLower, const Trendline& upper,
+                        const Trendline& lower, PatternData& pattern) {
+  const NumericVector& times = series.pipTimes;
+  
+  pattern.startIdx         = start;
+  pattern.leftShoulderIdx  = firstUpper;
+  pattern.necklineStartIdx = firstLower;
+  pattern.headIdx          = lastUpper;
+  pattern.necklineEndIdx   = lastLower;
+  pattern.rightShoulderIdx = -1;
+  
+  pattern.timeStamps  = {(int)times[start], (int)times[firstUpper], (int)times[firstLower],
+                         (int)times[lastUpper], (int)times[lastLower], NA_INTEGER, NA_INTEGER};
+  pattern.priceStamps = {series.pipPrices[start], upper.at(times[firstUpper]), lower.at(times[firstLower]),
+                         upper.at(times[lastUpper]), lower.at(times[lastLower]), NA_REAL, NA_REAL};
+  
+  pattern.breakoutIdx  = -1;
+  pattern.lastPointIdx = std::max(lastUpper, lastLower);
+}
+
+bool PatternDetector::detectBreakout(const SeriesData& series, int j,
+                                     const PatternData& pattern) const {
+  double line = linearInterpolation(pattern.lineX1, pattern.lineX2,
+                                    pattern.lineY1, pattern.lineY2,
+                                    series.times[j]);
+  return pattern.bearish ? series.prices[j] < line : series.prices[j] > line;
+}
+
+// Loop over the original data to find when the pattern's line is crossed = breakout
+int PatternDetector::searchBreakout(const SeriesData& series, int from,
+                                    const PatternData& pattern) const {
+  for (int j = from; j < series.prices.size()-1; ++j) {
+    
+    // If the original prices pass the last pattern point we can stop. The pattern would not be valid
+    bool passed = pattern.bearish ? series.prices[j] > pattern.invalidationPrice
+                                  : series.prices[j] < pattern.invalidationPrice;
+    if (passed && j != from) {
+      return -1;
+    }
+    
+    if (detectBreakout(series, j, pattern)) {
+      return j;
+    }
+  }
+  return -1;
+}
+
+bool findBreakout(const PatternDetector& detector, const SeriesData& series, PatternData& pattern) {
+  int j = detector.searchBreakout(series, series.indexFilter[pattern.lastPointIdx], pattern);
+  if (j < 0 || j >= series.prices.size()-1) {
+    return false;
+  }
+  
+  // We only buy if the next price (buyprice) has not passed the last pattern point
+  bool buy = pattern.bearish ? series.prices[j+1] < pattern.invalidationPrice
+                             : series.prices[j+1] > pattern.invalidationPrice;
+  if (!buy) {
+    return false;
+  }
+  pattern.breakoutIdx    = j;
+  pattern.timeStamps[6]  = series.times[j+1];
+  pattern.priceStamps[6] = series.prices[j+1];
+  return true;
+}
+
+// A trend is given by rising or falling highs and lows (the PIPs).
+// Bearish patterns are preceded by rising lows and followed by falling highs, bullish ones vice versa
+void calculateTrend(const SeriesData& series, PatternData& pattern) {
+  const NumericVector& prices = series.pipPrices;
+  const NumericVector& times  = series.pipTimes;
+  int i    = pattern.startIdx;
+  int last = pattern.lastPointIdx;
+  
+  pattern.trendBeginPrice = 0;
+  pattern.trendBeginTime  = 0;
+  if (i > 2) {
+    for (int rev = i; rev > 2; rev = rev-2) {
+      bool trend = pattern.bearish ? prices[rev] > prices[rev-2] : prices[rev] < prices[rev-2];
+      if (!trend) {
+        break;
+      }
+      pattern.trendBeginPrice = prices[rev-2];
+      pattern.trendBeginTime  = times[rev-2];
+    }
+  } else {
+    pattern.trendBeginPrice = -1;
+    pattern.trendBeginTime  = INVALID_TIME;
+  }
+  
+  pattern.trendEndPrice = 0;
+  pattern.trendEndTime  = 0;
+  if (last < (prices.size()-2)) {
+    for (int forward = last; forward < (prices.size()-2); forward = forward+2) {
+      bool trend = pattern.bearish ? prices[forward] > prices[forward+2] : prices[forward] < prices[forward+2];
+      if (!trend) {
+        break;
+      }
+      pattern.trendEndPrice = prices[forward+2];
+      pattern.trendEndTime  = times[forward+2];
+    }
+  } else {
+    pattern.trendEndPrice = -1;
+    pattern.trendEndTime  = INVALID_TIME;
+  }
+}
+
+// Signed margins of the SHS (iSHS) rules for all windows at once, in units of the local
+// volatility at the right shoulder. A rule holds if its margin is > 0. The minimum margin
+// of a window is its confidence
+Eigen::ArrayXd shsConfidence(const SeriesData& series, bool isInverted) {
+  const NumericVector& times  = series.pipTimes;
+  const NumericVector& prices = series.pipPrices;
+  int m = std::max((int)prices.size() - 5, 0);
+  if (m == 0) {
+    return Eigen::ArrayXd();
+  }
+  
+  // Point k of all windows is the PIP series shifted by k
+  auto P = [&](int k) { return Eigen::Map<const Eigen::ArrayXd>(prices.begin() + k, m); };
+  auto T = [&](int k) { return Eigen::Map<const Eigen::ArrayXd>(times.begin() + k, m); };
+  
+  // Neckline through the points 2 and 4, as in linearInterpolation
+  Eigen::ArrayXd slope = (P(4) - P(2)) / (T(4) - T(2));
+  auto neckline = [&](int k) { return (P(4) + slope * (T(k) - T(4))).eval(); };
+  
+  // iSHS rules are the SHS rules of the mirrored prices
+  double s = isInverted ? -1 : 1;
+  Eigen::ArrayXXd margins(m, 7);
+  margins.col(0) = s * (P(1) - P(0));                             // first point below the left shoulder
+  margins.col(1) = s * (P(2) - P(0));                             // ... and below the neckline start
+  margins.col(2) = s * (P(3) - P(1)) - MIN_HEAD_SHOULDER_DIFF;    // head above the left shoulder
+  margins.col(3) = s * (P(3) - P(5)) - MIN_HEAD_SHOULDER_DIFF;    // head above the right shoulder
+  margins.col(4) = s * (P(5) - neckline(5));                      // right shoulder above the neckline
+  margins.col(5) = s * (P(1) - neckline(1));                      // left shoulder above the neckline
+  margins.col(6) = s * (neckline(0) - P(0));                      // first point below the neckline
+  
+  // A flat series keeps the sign of the margins
+  RollingVolatility volatility(series.prices);
+  Eigen::ArrayXd sigma(m);
+  for (int i = 0; i < m; ++i) {
+    sigma[i] = std::max(volatility.at(series.indexFilter[i+5]), std::numeric_limits<double>::min());
+  }
+  return margins.rowwise().minCoeff() / sigma;
+}
+
+// Geometric features of all patterns at once. Each column is one array operation over the
+// patterns, missing pattern points (NA) make the dependent features NA
+Rcpp::DataFrame patternGeometry(const std::vector<PatternData>& patterns) {
+  int n = patterns.size();
+  Eigen::ArrayXXd T(n, 6), P(n, 6);
+  for (int r = 0; r < n; ++r) {
+    for (int k = 0; k < 6; ++k) {
+      int t = patterns[r].timeStamps[k];
+      T(r, k) = t == NA_INTEGER ? NA_REAL : t;
+      P(r, k) = patterns[r].priceStamps[k];
+    }
+  }
+  
+  auto slope = [&](int a, int b) {
+    return Eigen::ArrayXd::NullaryExpr(n, [&, a, b](Eigen::Index r) {
+      return getSlope(T(r, a), T(r, b), P(r, a), P(r, b));
+    }).eval();
+  };
+  Eigen::ArrayXXd segmentSlope(n, 5), segmentDuration(n, 5);
+  for (int k = 0; k < 5; ++k) {
+    segmentSlope.col(k)    = slope(k, k + 1);
+    segmentDuration.col(k) = T.col(k + 1) - T.col(k);
+  }
+  
+  // Neckline through the points 2 and 4, heights above it are taken as magnitudes so
+  // inverted formations get the same features
+  Eigen::ArrayXd necklineSlope = slope(2, 4);
+  auto height = [&](int k) { return (P.col(k) - (P.col(2) + necklineSlope * (T.col(k) - T.col(2)))).abs().eval(); };
+  Eigen::ArrayXd headHeight = height(3);
+  Eigen::ArrayXd shoulderTimeRatio  = (T.col(3) - T.col(1)) / (T.col(5) - T.col(3));
+  Eigen::ArrayXd shoulderPriceRatio = height(1) / height(5);
+  Eigen::ArrayXd headProminence     = (headHeight - height(1).max(height(5))) / headHeight;
+  
+  auto values = [](const Eigen::ArrayXd& column) {
+    return NumericVector(column.data(), column.data() + column.size());
+  };
+  return Rcpp::DataFrame::create(
+    Rcpp::Named("slope01")            = values(segmentSlope.col(0)),
+    Rcpp::Named("slope12")            = values(segmentSlope.col(1)),
+    Rcpp::Named("slope23")            = values(segmentSlope.col(2)),
+    Rcpp::Named("slope34")            = values(segmentSlope.col(3)),
+    Rcpp::Named("slope45")            = values(segmentSlope.col(4)),
+    Rcpp::Named("duration01")         = values(segmentDuration.col(0)),
+    Rcpp::Named("duration12")         = values(segmentDuration.col(1)),
+    Rcpp::Named("duration23")         = values(segmentDuration.col(2)),
+    Rcpp::Named("duration34")         = values(segmentDuration.col(3)),
+    Rcpp::Named("duration45")         = values(segmentDuration.col(4)),
+    Rcpp::Named("shoulderTimeRatio")  = values(shoulderTimeRatio),
+    Rcpp::Named("shoulderPriceRatio") = values(shoulderPriceRatio),
+    Rcpp::Named("headProminence")     = values(headProminence),
+    Rcpp::Named("necklineSlope")      = values(necklineSlope)
+  );
+}
+
+// Double top/bottom detection on the points 0..3 of the window
+bool detectDoubleExtreme(const PipWindow& window, bool isInverted, double tolerance) {
+  const double* prices = window.p;
+  
+  // Both extremes have to lie within the tolerance around their average
+  double average = (prices[1] + prices[3]) / 2;
+  bool equalExtremes = std::fabs(prices[1] - prices[3]) <= tolerance * std::fabs(average);
   
   if (isInverted) {
-    // iSHS pattern conditions
-    return (prices[i] > prices[i+1] &&             // First point must be a high
-            prices[i] > prices[i+2] &&             // First point higher than neckline start
-            prices[i+1] > prices[i+3] &&           // Left shoulder higher than head
-            prices[i+5] > prices[i+3] &&           // Right shoulder higher than head
-            prices[i+5] < rightNecklineValue &&    // Right shoulder below neckline
-            prices[i+1] < leftNecklineValue &&     // Left shoulder below neckline
-            prices[i] > firstPointNecklineValue);  // First point above neckline
+    // Double bottom conditions
+    return (equalExtremes &&
+            prices[2] > prices[1] &&    // Peak between the bottoms
+            prices[2] > prices[3] &&
+            prices[0] > prices[2]);     // First point above the peak
   } else {
-    // SHS pattern conditions
-    return (prices[i] < prices[i+1] &&             // First point must be a low
-            prices[i] < prices[i+2] &&             // First point lower than neckline start
-            prices[i+1] < prices[i+3] &&           // Left shoulder lower than head
-            prices[i+5] < prices[i+3] &&           // Right shoulder lower than head
-            prices[i+5] > rightNecklineValue &&    // Right shoulder above neckline
-            prices[i+1] > leftNecklineValue &&     // Left shoulder above neckline
-            prices[i] < firstPointNecklineValue);  // First point below neckline
+    // Double top conditions
+    return (equalExtremes &&
+            prices[2] < prices[1] &&    // Trough between the tops
+            prices[2] < prices[3] &&
+            prices[0] < prices[2]);     // First point below the trough
   }
 }
 
+// Triple top/bottom detection on the points 0..5 of the window.
+// The line through the troughs is the SHS neckline, its values come with the window
+bool detectTripleExtreme(const PipWindow& window, bool isInverted, double tolerance) {
+  const double* prices = window.p;
+  
+  // All three extremes have to lie within the tolerance band around their average
+  double average = (prices[1] + prices[3] + prices[5]) / 3;
+  double band = std::max(prices[1], std::max(prices[3], prices[5])) -
+                std::min(prices[1], std::min(prices[3], prices[5]));
+  bool equalExtremes = band <= tolerance * std::fabs(average);
+  
+  if (isInverted) {
+    // Triple bottom conditions
+    return (equalExtremes &&
+            prices[2] > prices[1] &&                      // Peaks between the bottoms
+            prices[2] > prices[3] &&
+            prices[4] > prices[3] &&
+            prices[4] > prices[5] &&
+            prices[5] < window.rightNecklineValue &&      // Bottoms below the resistance line
+            prices[1] < window.leftNecklineValue &&
+            prices[0] > window.firstPointNecklineValue);  // First point above the resistance line
+  } else {
+    // Triple top conditions
+    return (equalExtremes &&
+            prices[2] < prices[1] &&                      // Troughs between the tops
+            prices[2] < prices[3] &&
+            prices[4] < prices[3] &&
+            prices[4] < prices[5] &&
+            prices[5] > window.rightNecklineValue &&      // Tops above the support line
+            prices[1] > window.leftNecklineValue &&
+            prices[0] < window.firstPointNecklineValue);  // First point below the support line
+  }
+}
+
+// Broadening top/bottom detection on the points 0..5 of the window.
+// Bottoms are tops on mirrored prices; the conditions are combined without
+// short-circuit evaluation so the check compiles to straight-line code
+bool detectBroadening(const PipWindow& window, bool isInverted) {
+  const double* p = window.p;
+  double sign = 1 - 2 * (double)isInverted;
+  
+  return (sign * p[0] < sign * window.firstPointNecklineValue) &  // First point below the lows' line
+         (sign * p[2] < sign * p[1]) &                            // Alternating start
+         (sign * p[1] < sign * p[3]) &                            // Higher highs
+         (sign * p[3] < sign * p[5]) &
+         (sign * p[4] < sign * p[2]);                             // Lower lows
+}
+
 // Efficient return calculation
 void calculateReturns(const NumericVector& prices, const NumericVector& times,
                     int breakoutIdx, int patternStartIdx, std::vector<double>& returns,
-                    std::vector<double>& relReturns) {
+                    std::vector<double>& relReturns, const SessionIndex* sessions) {
   
   // Fixed time windows to check (1,3,5,10,30,60)
   const std::vector<int> fixedWindows = {1, 3, 5, 10, 30, 60};
@@ -394,7 +1127,8 @@ void calculateReturns(const NumericVector& prices, const NumericVector& times,
   }
   
   // Calculate pattern length for relative time windows
-  int patternLengthInDays = times[breakoutIdx] - times[patternStartIdx];
+  int patternLengthInDays = sessions ? sessions->distance(patternStartIdx, breakoutIdx)
+                                     : times[breakoutIdx] - times[patternStartIdx];
   
   // Calculate relative time differences
   int relDiff13 = patternLengthInDays/3;
@@ -417,8 +1151,38 @@ void calculateReturns(const NumericVector& prices, const NumericVector& times,
   // Breakout price (used for calculating returns)
   double breakoutPrice = prices[breakoutIdx];
   
+  auto storeFixed = [&](size_t w, int forward) {
+    // Calculate return: for iSHS use log return, for SHS just price
+    if (prices[breakoutIdx] > 0) {
+      returns[w] = prices[forward];
+    } else {
+      returns[w] = log(prices[forward] / breakoutPrice);
+    }
+    foundFixed[w] = true;
+  };
+  auto storeRel = [&](size_t w, int forward) {
+    // For relative returns, always use price ratio
+    relReturns[w] = prices[forward] / breakoutPrice;
+    foundRel[w] = true;
+  };
+  
+  // Horizons in sessions: the close of the session w sessions after the breakout,
+  // at least the next one. No scan needed
+  for(size_t w = 0; sessions && w < fixedWindows.size(); ++w) {
+    int forward = sessions->barAfter(breakoutIdx, std::max(fixedWindows[w], 1));
+    if(forward >= 0) {
+      storeFixed(w, forward);
+    }
+  }
+  for(size_t w = 0; sessions && w < relWindows.size(); ++w) {
+    int forward = sessions->barAfter(breakoutIdx, std::max(relWindows[w], 1));
+    if(forward >= 0) {
+      storeRel(w, forward);
+    }
+  }
+  
   // Loop through future data once, checking all time periods
-  for(int forward = breakoutIdx + 1; forward < prices.size(); ++forward) {
+  for(int forward = breakoutIdx + 1; !sessions && forward < prices.size(); ++forward) {
     
     // Calculate time difference from breakout point
     int timeDiff = times[forward] - times[breakoutIdx];
@@ -426,22 +1190,14 @@ void calculateReturns(const NumericVector& prices, const NumericVector& times,
     // Check each fixed window
     for(size_t w = 0; w < fixedWindows.size(); ++w) {
       if(!foundFixed[w] && timeDiff > fixedWindows[w]) {
-        // Calculate return: for iSHS use log return, for SHS just price
-        if (prices[breakoutIdx] > 0) {
-          returns[w] = prices[forward];
-        } else {
-          returns[w] = log(prices[forward] / breakoutPrice);
-        }
-        foundFixed[w] = true;
+        storeFixed(w, forward);
       }
     }
     
     // Check each relative window
     for(size_t w = 0; w < relWindows.size(); ++w) {
       if(!foundRel[w] && timeDiff > relWindows[w]) {
-        // For relative returns, always use price ratio
-        relReturns[w] = prices[forward] / breakoutPrice;
-        foundRel[w] = true;
+        storeRel(w, forward);
       }
     }
     
@@ -467,26 +1223,3 @@ void calculateReturns(const NumericVector& prices, const NumericVector& times,
     }
   }
 }
-
-// Example of a simple pool allocator for pattern data
-template <typename T>
-class PoolAllocator {
-    // Implementation of a memory pool for pattern data
-};
-
-// Use a more efficient approach for finding returns at different intervals
-void calculateReturns(std::vector<double>& returns, 
-                     const NumericVector& prices, 
-                     const NumericVector& times,
-                     int startIdx, int breakoutIdx,
-                     const std::vector<int>& timeIntervals) {
-    // More efficient return calculation
-}
-
-// Example of using SIMD with Eigen library
-void calculateMultipleInterpolations(const VectorXd& x, const VectorXd& y,
-                                    const VectorXd& queryPoints,
-                                    VectorXd& results) {
-    // Vectorized linear interpolation
- }
-
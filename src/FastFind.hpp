@@ -0,0 +1,297 @@
+#ifndef FastFind_hpp
+#define FastFind_hpp
+
+#include <vector>
+#include <string>
+#include <map>
+#include <array>
+#include <memory>
+#include "cppHeader.hpp"
+#include "Trendline.hpp"
+#include "RangeExtremum.hpp"
+#include "Volatility.hpp"
+#include "SessionIndex.hpp"
+
+/**
+ * @file FastFind.hpp
+ * @brief Shared types of the multi-pattern engine behind fastFind
+ *
+ * All detectors look at the same PIP window per loop position. A detector only
+ * decides whether its formation is present and describes the line whose crossing
+ * is the breakout. Breakout search, trend measurement and returns are shared.
+ */
+
+// PIPs loaded per loop position: 6 pattern points and the following PIP
+const int WINDOW_SIZE = 7;
+
+// Minimum price difference between head and shoulders of a SHS/iSHS
+const double MIN_HEAD_SHOULDER_DIFF = 0.01;
+
+// Trend time of patterns without a trend before or after them
+const int INVALID_TIME = 99999991;
+
+// The series a detector works on
+struct SeriesData {
+  const IntegerVector& indexFilter;   // PIP positions in the original series
+  const NumericVector& times;         // Original_times
+  const NumericVector& prices;        // Original_prices
+  const NumericVector& pipTimes;      // QuerySeries_times
+  const NumericVector& pipPrices;     // QuerySeries_prices
+};
+
+// PIP window, loaded once per loop position and shared by all detectors
+struct PipWindow {
+  int i;                      // position of the first PIP in the query series
+  int size;                   // number of loaded PIPs (less than WINDOW_SIZE at the end of the series)
+  double t[WINDOW_SIZE];      // times of the PIPs i..i+6
+  double p[WINDOW_SIZE];      // prices of the PIPs i..i+6
+  // Neckline through the points 2 and 4, evaluated at the points 0, 1 and 5
+  double firstPointNecklineValue;
+  double leftNecklineValue;
+  double rightNecklineValue;
+};
+
+// Pattern data. Indices are zero based here, -1 marks an unused pattern point
+struct PatternData {
+  int startIdx, leftShoulderIdx, necklineStartIdx, headIdx, necklineEndIdx, rightShoulderIdx, breakoutIdx;
+  std::string patternName;
+  std::vector<int> timeStamps;
+  std::vector<double> priceStamps;
+  double trendBeginPrice;
+  int trendBeginTime;
+  double trendEndPrice;
+  int trendEndTime;
+  std::vector<double> returns;       // Fixed time window returns
+  std::vector<double> relReturns;    // Relative time window returns
+
+  // Set by the detector
+  int lastPointIdx;                  // last pattern point (query series), the breakout search starts there
+  double lineX1, lineY1, lineX2, lineY2; // two points of the breakout line
+  double invalidationPrice;          // the pattern fails if this price is passed before the breakout
+  bool bearish;                      // breakout downwards (SHS) or upwards (iSHS)
+  double confidence = NA_REAL;       // smallest rule margin in volatility units, if the detector has one
+  double quality = NA_REAL;          // formation quality score in [0, 1], see formationQuality
+  double breakoutStrength = NA_REAL; // close beyond the breakout line in volatility units
+};
+
+// Per pattern: detected formations and formations with a valid breakout
+struct PatternCount {
+  int candidates = 0;
+  int breakouts  = 0;
+};
+
+// Define a common interface for all pattern detectors
+class PatternDetector {
+public:
+  virtual ~PatternDetector() = default;
+
+  // Called once per series before the window scan
+  virtual void prepare(const SeriesData& /*series*/) {}
+
+  // Number of PIPs the window needs for this detector
+  virtual int windowLength() const { return WINDOW_SIZE; }
+
+  // Returns true if a pattern is detected at the given window
+  virtual bool detect(const SeriesData& series, const PipWindow& window,
+                      PatternData& outPattern) const = 0;
+
+  // Returns true if the original series breaks out of the pattern at index j.
+  // The default crosses the line stored in the pattern
+  virtual bool detectBreakout(const SeriesData& series, int j,
+                              const PatternData& pattern) const;
+
+  // First index >= from where the series breaks out, -1 if the pattern is invalidated
+  // before. The default scans the original series with detectBreakout
+  virtual int searchBreakout(const SeriesData& series, int from,
+                             const PatternData& pattern) const;
+
+  // Get the name of this pattern
+  virtual std::string getName() const = 0;
+};
+
+// Ascending, descending and symmetric triangles (FastFind_Triangles.cpp)
+class TriangleDetector : public PatternDetector {
+public:
+  explicit TriangleDetector(double tolerance) : tolerance(tolerance) {}
+
+  void prepare(const SeriesData& series) override;
+
+  // Start point and at least 2 swing highs and 2 swing lows
+  int windowLength() const override { return 1 + 2 * MIN_LINE_POINTS; }
+
+  bool detect(const SeriesData& series, const PipWindow& window,
+              PatternData& outPattern) const override;
+
+  std::string getName() const override { return "TRI"; }
+
+private:
+  double tolerance;
+  TrendlineSums sums;
+  std::vector<int> runs;
+};
+
+// Rising and falling wedges (FastFind_Wedges.cpp)
+class WedgeDetector : public PatternDetector {
+public:
+  explicit WedgeDetector(double tolerance) : tolerance(tolerance) {}
+
+  void prepare(const SeriesData& series) override;
+
+  // Start point and at least 2 swing highs and 2 swing lows
+  int windowLength() const override { return 1 + 2 * MIN_LINE_POINTS; }
+
+  bool detect(const SeriesData& series, const PipWindow& window,
+              PatternData& outPattern) const override;
+
+  std::string getName() const override { return "WEDGE"; }
+
+private:
+  double tolerance;
+  TrendlineSums sums;
+  std::vector<int> runs;
+};
+
+// Rectangles / horizontal trading ranges (FastFind_Rectangles.cpp)
+class RectangleDetector : public PatternDetector {
+public:
+  explicit RectangleDetector(double tolerance) : tolerance(tolerance) {}
+
+  void prepare(const SeriesData& series) override;
+
+  // Start point and the minimum number of swing points
+  int windowLength() const override { return 1 + MIN_RECTANGLE_SWINGS; }
+
+  bool detect(const SeriesData& series, const PipWindow& window,
+              PatternData& outPattern) const override;
+
+  std::string getName() const override { return "RECT"; }
+
+  // Two touches of one side and three of the other, as RTOP/RBOT in Lo et al.
+  static const int MIN_RECTANGLE_SWINGS = 5;
+
+private:
+  double tolerance;
+  RangeExtremum original;        // Original_prices
+  std::vector<int> reach;        // last PIP of the longest trading range starting at each PIP
+};
+
+// Flags and pennants after a pole (FastFind_Flags.cpp)
+class FlagDetector : public PatternDetector {
+public:
+  explicit FlagDetector(double tolerance) : tolerance(tolerance) {}
+
+  void prepare(const SeriesData& series) override;
+
+  // Pole start and the minimum number of consolidation swing points
+  int windowLength() const override { return 1 + MIN_FLAG_SWINGS; }
+
+  bool detect(const SeriesData& series, const PipWindow& window,
+              PatternData& outPattern) const override;
+
+  std::string getName() const override { return "FLAG"; }
+
+  // Swing points of the consolidation, the pole end included
+  static const int MIN_FLAG_SWINGS = 4;
+  static const int MAX_FLAG_SWINGS = 7;
+
+private:
+  double tolerance;
+  RangeExtremum original;        // Original_prices
+  std::vector<bool> isPole;      // PIP move j -> j+1 is a pole candidate
+  std::vector<int> runs;
+  TrendlineSums sums;
+};
+
+// Cup-and-handle (FastFind_Cups.cpp)
+class CupDetector : public PatternDetector {
+public:
+  explicit CupDetector(double rimTolerance) : rimTolerance(rimTolerance) {}
+
+  // Fits all candidate cups of the series in one batch
+  void prepare(const SeriesData& series) override;
+
+  // Start, left rim, bottom, right rim and handle low
+  int windowLength() const override { return 5; }
+
+  bool detect(const SeriesData& series, const PipWindow& window,
+              PatternData& outPattern) const override;
+
+  std::string getName() const override { return "CUPH"; }
+
+  // PIPs from the left to the right rim (inclusive)
+  static const int MAX_CUP_SWINGS = 11;
+
+private:
+  double rimTolerance;
+  std::vector<int> rightRim;     // right rim of the cup starting at each left rim PIP, -1 if none
+};
+
+// Breaks of support lines through swing lows and resistance lines through swing highs
+// (FastFind_TrendlineBreaks.cpp)
+class TrendlineBreakDetector : public PatternDetector {
+public:
+  // Builds the hulls of the swing points and the range-extremum index once per series
+  void prepare(const SeriesData& series) override;
+
+  // A line is reported at the PIP of its second touch
+  int windowLength() const override { return 1; }
+
+  bool detect(const SeriesData& series, const PipWindow& window,
+              PatternData& outPattern) const override;
+
+  // First crossing of the line in Original_prices, whole blocks of the index are skipped
+  int searchBreakout(const SeriesData& series, int from,
+                     const PatternData& pattern) const override;
+
+  std::string getName() const override { return "TLB"; }
+
+private:
+  RangeExtremum original;        // Original_prices
+  std::vector<int> anchor;       // first touch of the hull edge ending at each swing PIP, -1 if none
+};
+
+// SHS/iSHS over non-consecutive PIPs (FastFind_GappedSHS.cpp)
+class GappedSHSDetector : public PatternDetector {
+public:
+  GappedSHSDetector(int maxGap, double tolerance) : maxGap(maxGap), tolerance(tolerance) {}
+
+  // Matches all start PIPs, per neckline and right shoulder (see FastFind_GappedSHS.cpp)
+  void prepare(const SeriesData& series) override;
+
+  // The 6 pattern points without gaps
+  int windowLength() const override { return 6; }
+
+  bool detect(const SeriesData& series, const PipWindow& window,
+              PatternData& outPattern) const override;
+
+  std::string getName() const override { return "GAPPED_SHS"; }
+
+private:
+  int maxGap;                             // minor swings (PIP pairs) skipped between two pattern points
+  double tolerance;                       // lowest accepted rule margin in volatility units, as shsTolerance
+  std::vector<std::array<int, 6>> match;  // pattern points per start PIP, -1 if there is no match
+  std::vector<double> confidence;         // smallest rule margin of the match per start PIP
+};
+
+// Shared engine helpers (FastFind.cpp)
+void loadWindow(const SeriesData& series, int i, PipWindow& window);
+void setPatternPoints(const PipWindow& window, int pointCount, PatternData& pattern);
+void setPatternPoints(const SeriesData& series, const std::vector<int>& pips, PatternData& pattern);
+void setBreakoutLine(double x1, double y1, double x2, double y2,
+                     double invalidationPrice, bool bearish, PatternData& pattern);
+void setTrendlinePoints(const SeriesData& series, int start, int firstUpper, int lastUpper,
+                        int firstLower, int lastLower, const Trendline& upper,
+                        const Trendline& lower, PatternData& pattern);
+bool findBreakout(const PatternDetector& detector, const SeriesData& series, PatternData& pattern);
+void calculateTrend(const SeriesData& series, PatternData& pattern);
+void calculateReturns(const NumericVector& prices, const NumericVector& times,
+                      int breakoutIdx, int patternStartIdx, std::vector<double>& returns,
+                      std::vector<double>& relReturns, const SessionIndex* sessions = nullptr);
+std::unique_ptr<PatternDetector> createDetector(const std::string& patternName,
+                                                double peakTolerance, double lineTolerance);
+std::vector<bool> overlapWinners(const std::vector<std::string>& names, const std::vector<double>& starts,
+                                 const std::vector<double>& ends, const std::vector<double>& scores);
+Rcpp::List patternResults(const std::vector<PatternData>& patterns,
+                          const std::map<std::string, PatternCount>& counts);
+
+#endif
@@ -0,0 +1,144 @@
+#include <vector>
+#include <cmath>
+#include <algorithm>
+#include "FastFind.hpp"
+#include <Eigen/Dense>
+
+/**
+ * @file FastFind_Cups.cpp
+ * @brief Cup-and-handle detection for the fastFind engine
+ *
+ * A cup is a rounded U between two swing highs of about the same price. Every span
+ * between a left and a right rim candidate gets a quadratic least-squares fit over
+ * Original_prices. Prefix sums of y, x*y, x^2*y and y^2 make each fit O(1), and all
+ * candidates of a series are solved together as Eigen array expressions.
+ */
+
+// Minimum R^2 of the quadratic fit
+const double MIN_CUP_FIT = 0.8;
+// Depth of the cup relative to the rim
+const double MIN_CUP_DEPTH = 0.1;
+const double MAX_CUP_DEPTH = 0.5;
+// The handle retraces at most this part of the cup depth ...
+const double MAX_HANDLE_RETRACEMENT = 0.5;
+// ... and takes at most this part of the cup's duration
+const double MAX_HANDLE_DURATION = 0.5;
+
+void CupDetector::prepare(const SeriesData& series) {
+  const NumericVector& prices = series.pipPrices;
+  const NumericVector& y      = series.prices;
+  const IntegerVector& idx    = series.indexFilter;
+  int n = prices.size();
+  
+  // Moment prefix sums over the original series, x is the observation index
+  int m = y.size();
+  std::vector<long double> sy(m + 1, 0), sxy(m + 1, 0), sxxy(m + 1, 0), syy(m + 1, 0);
+  for (int k = 0; k < m; ++k) {
+    long double x = k;
+    sy[k+1]   = sy[k]   + y[k];
+    sxy[k+1]  = sxy[k]  + x * y[k];
+    sxxy[k+1] = sxxy[k] + x * x * y[k];
+    syy[k+1]  = syy[k]  + (long double)y[k] * y[k];
+  }
+  
+  // Candidate spans: swing high to a later swing high of about the same price,
+  // with a PIP after the right rim for the handle
+  std::vector<int> runs = alternatingRuns(prices);
+  std::vector<int> left, right;
+  for (int l = 1; l < n; ++l) {
+    if (prices[l] <= prices[l-1]) {
+      continue;
+    }
+    int maxRight = std::min(l + MAX_CUP_SWINGS - 1, l + runs[l] - 2);
+    for (int r = l + 2; r <= maxRight; r += 2) {
+      if (std::fabs(prices[r] - prices[l]) <= rimTolerance * prices[l]) {
+        left.push_back(l);
+        right.push_back(r);
+      }
+    }
+  }
+  
+  // Centered moments of the whole batch. With x centered on the span the odd
+  // moments of x vanish and the normal equations decouple
+  int batch = left.size();
+  Eigen::ArrayXd w(batch), t0(batch), t1(batch), t2(batch), yy(batch), rim(batch);
+  for (int c = 0; c < batch; ++c) {
+    int s = idx[left[c]];
+    int e = idx[right[c]];
+    long double mid = (s + e) / 2.0L;
+    long double Sy   = sy[e+1]   - sy[s];
+    long double Sxy  = sxy[e+1]  - sxy[s];
+    long double Sxxy = sxxy[e+1] - sxxy[s];
+    w(c)   = e - s + 1;
+    t0(c)  = Sy;
+    t1(c)  = Sxy - mid * Sy;
+    t2(c)  = Sxxy - 2 * mid * Sxy + mid * mid * Sy;
+    yy(c)  = syy[e+1] - syy[s];
+    rim(c) = std::min(prices[left[c]], prices[right[c]]);
+  }
+  
+  // Sums of x^2 and x^4 over w centered integer positions
+  Eigen::ArrayXd m2 = w * (w.square() - 1) / 12;
+  Eigen::ArrayXd m4 = w * (w.square() - 1) * (3 * w.square() - 7) / 240;
+  
+  // y = a + b*x + c*x^2
+  Eigen::ArrayXd c = (w * t2 - m2 * t0) / (w * m4 - m2.square());
+  Eigen::ArrayXd b = t1 / m2;
+  Eigen::ArrayXd a = (t0 - m2 * c) / w;
+  
+  Eigen::ArrayXd sse = yy - a * t0 - b * t1 - c * t2;
+  Eigen::ArrayXd sst = yy - t0.square() / w;
+  Eigen::ArrayXd r2  = 1 - sse / sst;
+  
+  // Vertex of the parabola (relative to the span center) and depth below the rim
+  Eigen::ArrayXd vertex = -b / (2 * c);
+  Eigen::ArrayXd depth  = (rim - (a - b.square() / (4 * c))) / rim;
+  
+  // Rounded U: opens upwards, good fit, bottom in the middle third of the span
+  rightRim.assign(n, -1);
+  for (int k = 0; k < batch; ++k) {
+    bool cup = c(k) > 0 && r2(k) >= MIN_CUP_FIT &&
+               std::fabs(vertex(k)) <= w(k) / 6 &&
+               depth(k) >= MIN_CUP_DEPTH && depth(k) <= MAX_CUP_DEPTH;
+    // Candidates are ordered by right rim, so the longest cup per left rim wins
+    if (cup) {
+      rightRim[left[k]] = right[k];
+    }
+  }
+}
+
+bool CupDetector::detect(const SeriesData& series, const PipWindow& window,
+                         PatternData& outPattern) const {
+  const NumericVector& prices = series.pipPrices;
+  const IntegerVector& idx    = series.indexFilter;
+  
+  int i     = window.i;
+  int left  = i + 1;
+  int right = rightRim[left];
+  if (right < 0) {
+    return false;
+  }
+  
+  // Lowest PIP between the rims
+  int bottom = left + 1;
+  for (int k = left + 3; k < right; k += 2) {
+    if (prices[k] < prices[bottom]) {
+      bottom = k;
+    }
+  }
+  
+  // Shallow and short handle after the right rim
+  int handle   = right + 1;
+  double depth = prices[right] - prices[bottom];
+  if (prices[right] - prices[handle] > MAX_HANDLE_RETRACEMENT * depth ||
+      idx[handle] - idx[right] > MAX_HANDLE_DURATION * (idx[right] - idx[left])) {
+    return false;
+  }
+  
+  setPatternPoints(series, {i, left, bottom, right, handle}, outPattern);
+  outPattern.patternName = getName();
+  // Breakout above the right rim, invalid below the handle low
+  setBreakoutLine(series.pipTimes[right], prices[right], series.pipTimes[handle], prices[right],
+                  prices[handle], false, outPattern);
+  return true;
+}
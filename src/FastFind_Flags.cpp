@@ -0,0 +1,128 @@
+#include <vector>
+#include <cmath>
+#include <algorithm>
+#include "FastFind.hpp"
+
+/**
+ * @file FastFind_Flags.cpp
+ * @brief Flag and pennant detection for the fastFind engine
+ *
+ * Pole candidates are PIP-to-PIP moves that are large compared to the volatility
+ * before them. They are marked once per series, so the window scan only looks at the
+ * consolidation after a pole: its bounds come from range queries over Original_prices
+ * and its trendlines from the O(1) fits in Trendline.hpp.
+ */
+
+// A pole moves at least this many standard deviations (scaled to its length)
+const double MIN_POLE_STRENGTH = 3.0;
+// The consolidation takes at most this many times as long as the pole
+const int MAX_FLAG_TO_POLE_DURATION = 4;
+// The consolidation retraces at most this part of the pole
+const double MAX_FLAG_RETRACEMENT = 0.5;
+// The gap between pennant lines shrinks at least to this part
+const double PENNANT_CONVERGENCE = 0.5;
+
+void FlagDetector::prepare(const SeriesData& series) {
+  const NumericVector& prices = series.pipPrices;
+  int n = prices.size();
+  
+  original = RangeExtremum(series.prices);
+  runs     = alternatingRuns(prices);
+  sums     = TrendlineSums(series.pipTimes, prices);
+  
+  // Move of every PIP to the next one in units of the volatility before the move
+  RollingVolatility volatility(series.prices);
+  isPole.assign(n, false);
+  for (int j = 0; j + 1 < n; ++j) {
+    int poleStart = series.indexFilter[j];
+    int poleBars  = series.indexFilter[j+1] - poleStart;
+    double sigma  = volatility.at(poleStart);
+    if (sigma <= 0 || poleBars <= 0) {
+      continue;
+    }
+    double strength = std::fabs(prices[j+1] - prices[j]) / (sigma * std::sqrt((double)poleBars));
+    isPole[j] = strength >= MIN_POLE_STRENGTH;
+  }
+}
+
+bool FlagDetector::detect(const SeriesData& series, const PipWindow& window,
+                          PatternData& outPattern) const {
+  const NumericVector& times  = series.pipTimes;
+  const NumericVector& prices = series.pipPrices;
+  const IntegerVector& idx    = series.indexFilter;
+  
+  int i = window.i;
+  if (!isPole[i]) {
+    return false;
+  }
+  
+  // The pole runs from PIP i to PIP i+1, the consolidation starts at its end
+  int first      = i + 1;
+  bool bullish   = prices[first] > prices[i];
+  double height  = std::fabs(prices[first] - prices[i]);
+  int poleBars   = idx[first] - idx[i];
+  int maxSwings  = std::min(MAX_FLAG_SWINGS, runs[first]);
+  
+  // Longest consolidation first
+  for (int swings = maxSwings; swings >= MIN_FLAG_SWINGS; --swings) {
+    int last = first + swings - 1;
+    if (idx[last] - idx[first] > MAX_FLAG_TO_POLE_DURATION * poleBars) {
+      continue;
+    }
+    
+    // Tight: the pole end stays the extreme and the retracement is shallow
+    double high = original.max(idx[first], idx[last]);
+    double low  = original.min(idx[first], idx[last]);
+    bool tight  = bullish ? high <= prices[first] && prices[first] - low <= MAX_FLAG_RETRACEMENT * height
+                          : low >= prices[first] && high - prices[first] <= MAX_FLAG_RETRACEMENT * height;
+    if (!tight) {
+      continue;
+    }
+    
+    int firstHigh = bullish ? first : first + 1;
+    int firstLow  = bullish ? first + 1 : first;
+    int lastHigh  = firstHigh + 2 * ((last - firstHigh) / 2);
+    int lastLow   = firstLow  + 2 * ((last - firstLow)  / 2);
+    
+    Trendline upper = sums.fit(firstHigh, (lastHigh - firstHigh) / 2 + 1);
+    Trendline lower = sums.fit(firstLow,  (lastLow  - firstLow)  / 2 + 1);
+    
+    double tStart = times[first];
+    double tEnd   = times[last];
+    double limit  = tolerance * std::fabs(prices[first]);
+    if (upper.rmse > limit || lower.rmse > limit) {
+      continue;
+    }
+    
+    double upperMove = upper.slope * (tEnd - tStart);
+    double lowerMove = lower.slope * (tEnd - tStart);
+    double gapStart  = upper.at(tStart) - lower.at(tStart);
+    double gapEnd    = upper.at(tEnd)   - lower.at(tEnd);
+    
+    // Flag: parallel lines drifting against the pole. Pennant: converging lines
+    bool parallel   = std::fabs(upperMove - lowerMove) <= limit;
+    bool counter    = bullish ? upperMove + lowerMove <= 0 : upperMove + lowerMove >= 0;
+    bool converging = gapEnd > 0 && gapEnd < PENNANT_CONVERGENCE * gapStart &&
+                      upperMove <= 0 && lowerMove >= 0;
+    
+    std::string name;
+    if (parallel && counter) {
+      name = bullish ? "BULLF" : "BEARF";
+    } else if (converging) {
+      name = bullish ? "BULLP" : "BEARP";
+    } else {
+      continue;
+    }
+    
+    setTrendlinePoints(series, i, firstHigh, lastHigh, firstLow, lastLow, upper, lower, outPattern);
+    outPattern.patternName = name;
+    
+    // Breakout in the direction of the pole, invalid beyond the other side of the consolidation
+    const Trendline& line = bullish ? upper : lower;
+    setBreakoutLine(tStart, line.at(tStart), tEnd, line.at(tEnd),
+                    bullish ? low : high, !bullish, outPattern);
+    return true;
+  }
+  
+  return false;
+}
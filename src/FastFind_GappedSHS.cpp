@@ -0,0 +1,188 @@
+#include <vector>
+#include <array>
+#include <cmath>
+#include <limits>
+#include <algorithm>
+#include "FastFind.hpp"
+
+/**
+ * @file FastFind_GappedSHS.cpp
+ * @brief SHS/iSHS detection over non-consecutive PIPs for the fastFind engine
+ *
+ * Consecutive pattern points may be up to maxGap minor swings (PIP pairs) apart, as
+ * long as the skipped PIPs stay between the two points, i.e. the points remain the
+ * extremes of their leg. The rules are the margins of shsConfidence, scaled by the local
+ * volatility at the right shoulder, so shsTolerance and the confidence column mean the
+ * same as without gaps. Of all matches of a start the one with the largest swings wins.
+ *
+ * The later rules depend on the earlier points (the neckline runs through the points 2
+ * and 4 and the shoulders are tested against it), so partial matches cannot be kept per
+ * (PIP, stage) alone. Once the neckline and the right shoulder are fixed, the threshold
+ * of the margins is known and every rule involves at most one of the remaining points,
+ * except head above left shoulder. So the left shoulders are kept per neckline start and
+ * the heads per neckline end, both sorted by price, and one merge pass gives every head
+ * its best left shoulder. With g = maxGap + 1 choices per leg a start takes O(g^4)
+ * instead of enumerating its g^5 subsequences, a series O(n * g^4).
+ *
+ * Prices of iSHS are mirrored, so both formations are checked by the SHS rules.
+ */
+
+// Pattern stages: start, left shoulder, neckline start, head, neckline end, right shoulder
+const int SHS_STAGES = 6;
+
+void GappedSHSDetector::prepare(const SeriesData& series) {
+  const NumericVector& times  = series.pipTimes;
+  const NumericVector& prices = series.pipPrices;
+  int n = prices.size();
+
+  RangeExtremum pipIndex(prices);
+  RollingVolatility volatility(series.prices);
+
+  std::array<int, SHS_STAGES> noMatch;
+  noMatch.fill(-1);
+  match.assign(n, noMatch);
+  confidence.assign(n, NA_REAL);
+
+  // The PIPs between a and b lie within the leg from a to b
+  auto clearLeg = [&](int a, int b) {
+    if (b - a < 2) {
+      return true;
+    }
+    double low  = std::min(prices[a], prices[b]);
+    double high = std::max(prices[a], prices[b]);
+    return pipIndex.min(a + 1, b - 1) >= low && pipIndex.max(a + 1, b - 1) <= high;
+  };
+  // Possible next pattern points after a: up to maxGap minor swings later
+  auto nextPoints = [&](int a, std::vector<int>& points) {
+    points.clear();
+    for (int b = a + 1; b < n && b <= a + 1 + 2 * maxGap; b += 2) {
+      if (clearLeg(a, b)) {
+        points.push_back(b);
+      }
+    }
+  };
+
+  // Left shoulders per neckline start and heads per neckline end, by offset from the start
+  int span = (SHS_STAGES - 1) * (1 + 2 * maxGap);
+  std::vector<std::vector<int>> leftShoulders(span + 1), heads(span + 1);
+  std::vector<int> necklineStarts, necklineEnds, first, second;
+
+  for (int i = 0; i + SHS_STAGES <= n; ++i) {
+    // SHS start at a low, iSHS at a high
+    if (prices[i] == prices[i+1]) {
+      continue;
+    }
+    double sign = prices[i] < prices[i+1] ? 1 : -1;
+    auto q = [&](int j) { return sign * prices[j]; };
+    auto swing = [&](int a, int b) { return std::fabs(prices[b] - prices[a]); };
+    auto byPrice = [&](int a, int b) { return q(a) < q(b); };
+
+    necklineStarts.clear();
+    nextPoints(i, first);
+    for (int p1 : first) {
+      nextPoints(p1, second);
+      for (int p2 : second) {
+        if (q(p2) < q(p1)) {
+          if (leftShoulders[p2-i].empty()) {
+            necklineStarts.push_back(p2);
+          }
+          leftShoulders[p2-i].push_back(p1);
+        }
+      }
+    }
+
+    double bestSwing = -1;
+    for (int p2 : necklineStarts) {
+      std::vector<int>& lefts = leftShoulders[p2-i];
+      std::sort(lefts.begin(), lefts.end(), byPrice);
+
+      necklineEnds.clear();
+      nextPoints(p2, first);
+      for (int p3 : first) {
+        nextPoints(p3, second);
+        for (int p4 : second) {
+          if (q(p4) < q(p3)) {
+            if (heads[p4-i].empty()) {
+              necklineEnds.push_back(p4);
+            }
+            heads[p4-i].push_back(p3);
+          }
+        }
+      }
+
+      for (int p4 : necklineEnds) {
+        std::vector<int>& tops = heads[p4-i];
+        std::sort(tops.begin(), tops.end(), byPrice);
+        auto neckline = [&](int j) { return linearInterpolation(times[p2], times[p4], q(p2), q(p4), times[j]); };
+
+        nextPoints(p4, first);
+        for (int p5 : first) {
+          if (!(q(p5) > q(p4))) {
+            continue;
+          }
+          // A flat series keeps the sign of the margins
+          double sigma = std::max(volatility.at(series.indexFilter[p5]), std::numeric_limits<double>::min());
+          double threshold = tolerance * sigma;
+          double fixedMargin = std::min({q(p2) - q(i),              // start below the neckline start
+                                         neckline(i) - q(i),        // ... and below the neckline
+                                         q(p5) - neckline(p5)});    // right shoulder above the neckline
+          if (!(fixedMargin > threshold)) {
+            continue;
+          }
+
+          // Higher heads admit more left shoulders below them
+          size_t admitted = 0;
+          int left = -1;
+          double leftSwing = -1;
+          for (int p3 : tops) {
+            for (; admitted < lefts.size() &&
+                   q(p3) - q(lefts[admitted]) - MIN_HEAD_SHOULDER_DIFF > threshold; ++admitted) {
+              int p1 = lefts[admitted];
+              double margin = std::min(q(p1) - q(i),              // start below the left shoulder
+                                       q(p1) - neckline(p1));     // left shoulder above the neckline
+              if (margin > threshold && swing(i, p1) + swing(p1, p2) > leftSwing) {
+                left = p1;
+                leftSwing = swing(i, p1) + swing(p1, p2);
+              }
+            }
+            double headMargin = q(p3) - q(p5) - MIN_HEAD_SHOULDER_DIFF;  // head above the right shoulder
+            double total = leftSwing + swing(p2, p3) + swing(p3, p4) + swing(p4, p5);
+            if (left < 0 || !(headMargin > threshold) || total <= bestSwing) {
+              continue;
+            }
+            bestSwing = total;
+            match[i] = {i, left, p2, p3, p4, p5};
+            confidence[i] = std::min({fixedMargin, headMargin, q(left) - q(i), q(left) - neckline(left),
+                                      q(p3) - q(left) - MIN_HEAD_SHOULDER_DIFF}) / sigma;
+          }
+        }
+      }
+      for (int p4 : necklineEnds) {
+        heads[p4-i].clear();
+      }
+    }
+    for (int p2 : necklineStarts) {
+      leftShoulders[p2-i].clear();
+    }
+  }
+}
+
+bool GappedSHSDetector::detect(const SeriesData& series, const PipWindow& window,
+                               PatternData& outPattern) const {
+  const NumericVector& times  = series.pipTimes;
+  const NumericVector& prices = series.pipPrices;
+  const std::array<int, SHS_STAGES>& points = match[window.i];
+  if (points[0] < 0) {
+    return false;
+  }
+
+  setPatternPoints(series, std::vector<int>(points.begin(), points.end()), outPattern);
+
+  // Breakout through the neckline, invalid beyond the right shoulder
+  bool bearish = prices[points[0]] < prices[points[1]];
+  outPattern.patternName = bearish ? "SHS" : "iSHS";
+  outPattern.confidence  = confidence[window.i];
+  setBreakoutLine(times[points[2]], prices[points[2]], times[points[4]], prices[points[4]],
+                  prices[points[5]], bearish, outPattern);
+  return true;
+}
@@ -0,0 +1,98 @@
+#include <vector>
+#include <cmath>
+#include <limits>
+#include <algorithm>
+#include "FastFind.hpp"
+
+/**
+ * @file FastFind_Rectangles.cpp
+ * @brief Rectangle (trading range) detection for the fastFind engine
+ *
+ * A trading range is a run of alternating PIPs whose swing highs all lie within the
+ * tolerance below the ceiling and whose swing lows lie within the tolerance above the
+ * floor. Ceiling and floor are the max/min of Original_prices over the range, the bands
+ * are relative to the floor.
+ *
+ * Growing the range raises the ceiling and lowers the floor, which also narrows the
+ * bands. So shrinking a valid range keeps it valid, and the longest range per start PIP
+ * is found with one two-pointer sweep. Every containment test is a handful of range-extremum
+ * queries, which makes the sweep O(n log n) including the index build.
+ */
+
+void RectangleDetector::prepare(const SeriesData& series) {
+  const NumericVector& prices = series.pipPrices;
+  int n = prices.size();
+  
+  // Swing highs for the min query and swing lows for the max query, the other side is masked
+  std::vector<double> highs(n), lows(n);
+  for (int j = 0; j < n; ++j) {
+    bool isHigh = j > 0 ? prices[j] > prices[j-1] : (n > 1 && prices[0] > prices[1]);
+    highs[j] = isHigh ? prices[j] : std::numeric_limits<double>::infinity();
+    lows[j]  = isHigh ? -std::numeric_limits<double>::infinity() : prices[j];
+  }
+  
+  original = RangeExtremum(series.prices);
+  RangeExtremum highIndex(highs);
+  RangeExtremum lowIndex(lows);
+  std::vector<int> runs = alternatingRuns(prices);
+  
+  // Highs at the ceiling and lows at the floor between the PIPs first and last
+  auto isTradingRange = [&](int first, int last) {
+    double ceiling = original.max(series.indexFilter[first], series.indexFilter[last]);
+    double floor   = original.min(series.indexFilter[first], series.indexFilter[last]);
+    double band    = tolerance * floor;
+    return highIndex.min(first, last) >= ceiling - band &&
+           lowIndex.max(first, last)  <= floor + band;
+  };
+  
+  reach.assign(n, 0);
+  int last = 0;
+  for (int first = 0; first < n; ++first) {
+    last = std::max(last, first);
+    while (last + 1 < n && last + 1 < first + runs[first] && isTradingRange(first, last + 1)) {
+      ++last;
+    }
+    reach[first] = last;
+  }
+}
+
+bool RectangleDetector::detect(const SeriesData& series, const PipWindow& window,
+                               PatternData& outPattern) const {
+  const NumericVector& times  = series.pipTimes;
+  const NumericVector& prices = series.pipPrices;
+  
+  int i     = window.i;
+  int first = i + 1;
+  int last  = reach[first];
+  
+  // Enough touches, and only the longest range (not its shifted tails) is reported
+  if (last - first + 1 < MIN_RECTANGLE_SWINGS || reach[i] >= last) {
+    return false;
+  }
+  
+  double ceiling = original.max(series.indexFilter[first], series.indexFilter[last]);
+  double floor   = original.min(series.indexFilter[first], series.indexFilter[last]);
+  // The range has to be wider than the bands around ceiling and floor
+  if (ceiling - floor <= 2 * tolerance * floor) {
+    return false;
+  }
+  
+  bool firstIsHigh = prices[first] > prices[i];
+  int firstHigh = firstIsHigh ? first : first + 1;
+  int firstLow  = firstIsHigh ? first + 1 : first;
+  int lastHigh  = firstHigh + 2 * ((last - firstHigh) / 2);
+  int lastLow   = firstLow  + 2 * ((last - firstLow)  / 2);
+  
+  Trendline upper = {0, ceiling, 0};
+  Trendline lower = {0, floor, 0};
+  setTrendlinePoints(series, i, firstHigh, lastHigh, firstLow, lastLow, upper, lower, outPattern);
+  
+  // The range continues the move into it: RTOP (entered from below) breaks out above
+  // the ceiling, RBOT below the floor. Leaving on the other side invalidates it
+  bool bullish = firstIsHigh;
+  outPattern.patternName = bullish ? "RTOP" : "RBOT";
+  double level = bullish ? ceiling : floor;
+  setBreakoutLine(times[first], level, times[last], level,
+                  bullish ? floor : ceiling, !bullish, outPattern);
+  return true;
+}
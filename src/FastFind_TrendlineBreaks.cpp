@@ -0,0 +1,104 @@
+#include <vector>
+#include <cmath>
+#include <limits>
+#include <algorithm>
+#include "FastFind.hpp"
+
+/**
+ * @file FastFind_TrendlineBreaks.cpp
+ * @brief Trendline break detection for the fastFind engine
+ *
+ * The lower convex hull of the swing lows and the upper hull of the swing highs are
+ * kept incrementally while the PIPs are read in time order. When a swing point joins
+ * its hull, the edge to the previous hull vertex is a trendline: all swing points of
+ * the same side in between lie beyond it. Every swing point is pushed and popped at
+ * most once, so all lines of a series are found in O(n) instead of testing O(n^2)
+ * pairs. The break is the first crossing of the line in Original_prices, searched on
+ * a range-extremum index.
+ */
+
+// Swing points (PIPs) of one side on a trendline edge, the two touches included
+const int MIN_TRENDLINE_SWINGS = 3;
+
+// Cross product of (a - o) and (b - o) in the time-price plane
+static double cross(const NumericVector& t, const NumericVector& p, int o, int a, int b) {
+  return (t[a] - t[o]) * (p[b] - p[o]) - (p[a] - p[o]) * (t[b] - t[o]);
+}
+
+void TrendlineBreakDetector::prepare(const SeriesData& series) {
+  const NumericVector& times  = series.pipTimes;
+  const NumericVector& prices = series.pipPrices;
+  int n = prices.size();
+
+  original = RangeExtremum(series.prices);
+  anchor.assign(n, -1);
+
+  // Hull vertices and the running number of swing points per side
+  std::vector<int> lowerHull, upperHull;
+  std::vector<int> swingRank(n, 0);
+  int lowCount = 0, highCount = 0;
+
+  for (int j = 0; j < n; ++j) {
+    bool belowLeft  = j == 0     || prices[j] < prices[j-1];
+    bool belowRight = j == n - 1 || prices[j] < prices[j+1];
+    bool aboveLeft  = j == 0     || prices[j] > prices[j-1];
+    bool aboveRight = j == n - 1 || prices[j] > prices[j+1];
+
+    if (belowLeft && belowRight) {
+      // Lower hull: only left turns remain
+      while (lowerHull.size() >= 2 &&
+             cross(times, prices, lowerHull[lowerHull.size()-2], lowerHull.back(), j) <= 0) {
+        lowerHull.pop_back();
+      }
+      swingRank[j] = lowCount++;
+      if (!lowerHull.empty() && swingRank[j] - swingRank[lowerHull.back()] + 1 >= MIN_TRENDLINE_SWINGS) {
+        anchor[j] = lowerHull.back();
+      }
+      lowerHull.push_back(j);
+    } else if (aboveLeft && aboveRight) {
+      // Upper hull: only right turns remain
+      while (upperHull.size() >= 2 &&
+             cross(times, prices, upperHull[upperHull.size()-2], upperHull.back(), j) >= 0) {
+        upperHull.pop_back();
+      }
+      swingRank[j] = highCount++;
+      if (!upperHull.empty() && swingRank[j] - swingRank[upperHull.back()] + 1 >= MIN_TRENDLINE_SWINGS) {
+        anchor[j] = upperHull.back();
+      }
+      upperHull.push_back(j);
+    }
+  }
+}
+
+bool TrendlineBreakDetector::detect(const SeriesData& series, const PipWindow& window,
+                                    PatternData& outPattern) const {
+  const NumericVector& times  = series.pipTimes;
+  const NumericVector& prices = series.pipPrices;
+
+  int last  = window.i;
+  int first = anchor[last];
+  if (first < 0) {
+    return false;
+  }
+
+  setPatternPoints(series, {first, last}, outPattern);
+
+  // A support line (through swing lows) breaks downwards, a resistance line upwards.
+  // The line holds until it is broken, so nothing invalidates it
+  bool support = prices[last] < prices[last-1];
+  outPattern.patternName = support ? "SUPB" : "RESB";
+  double never = support ? std::numeric_limits<double>::infinity()
+                         : -std::numeric_limits<double>::infinity();
+  setBreakoutLine(times[first], prices[first], times[last], prices[last], never, support, outPattern);
+  return true;
+}
+
+// from is the second touch. The touches lie on the line, but rounding in slope and intercept
+// can put them marginally beyond it, so the search starts at the bar after the touch
+int TrendlineBreakDetector::searchBreakout(const SeriesData& series, int from,
+                                           const PatternData& pattern) const {
+  double slope     = (pattern.lineY2 - pattern.lineY1) / (pattern.lineX2 - pattern.lineX1);
+  double intercept = pattern.lineY1 - slope * pattern.lineX1;
+  return pattern.bearish ? original.firstBelowLine(from + 1, series.times, slope, intercept)
+                         : original.firstAboveLine(from + 1, series.times, slope, intercept);
+}
@@ -0,0 +1,91 @@
+#include <vector>
+#include <cmath>
+#include <algorithm>
+#include "FastFind.hpp"
+
+/**
+ * @file FastFind_Triangles.cpp
+ * @brief Triangle detection for the fastFind engine
+ *
+ * An upper trendline through 2-5 swing highs and a lower one through 2-5 swing lows
+ * are fitted for every window position. The regression sums are prepared once per
+ * series (see Trendline.hpp), so every fit and convergence test is O(1).
+ */
+
+void TriangleDetector::prepare(const SeriesData& series) {
+  sums = TrendlineSums(series.pipTimes, series.pipPrices);
+  runs = alternatingRuns(series.pipPrices);
+}
+
+bool TriangleDetector::detect(const SeriesData& series, const PipWindow& window,
+                              PatternData& outPattern) const {
+  const NumericVector& times  = series.pipTimes;
+  const NumericVector& prices = series.pipPrices;
+  
+  int i     = window.i;
+  int first = i + 1;
+  
+  // The swing points have to alternate, the point before them is the start of the move
+  bool firstIsHigh = prices[first] > prices[i];
+  int maxSwings = std::min(2 * MAX_LINE_POINTS, runs[i] - 1);
+  
+  // Longest formation first
+  for (int swings = maxSwings; swings >= 2 * MIN_LINE_POINTS; --swings) {
+    int last      = first + swings - 1;
+    int firstHigh = firstIsHigh ? first : first + 1;
+    int firstLow  = firstIsHigh ? first + 1 : first;
+    int lastHigh  = firstHigh + 2 * ((last - firstHigh) / 2);
+    int lastLow   = firstLow  + 2 * ((last - firstLow)  / 2);
+    
+    Trendline upper = sums.fit(firstHigh, (lastHigh - firstHigh) / 2 + 1);
+    Trendline lower = sums.fit(firstLow,  (lastLow  - firstLow)  / 2 + 1);
+    
+    double tStart = times[first];
+    double tEnd   = times[last];
+    
+    // Converging lines, the apex lies after the last swing point
+    double gapStart = upper.at(tStart) - lower.at(tStart);
+    double gapEnd   = upper.at(tEnd)   - lower.at(tEnd);
+    if (gapEnd <= 0 || gapEnd >= gapStart) {
+      continue;
+    }
+    
+    // The swing points have to lie on the lines
+    double limit = tolerance * std::fabs(upper.at(tStart) + lower.at(tStart)) / 2;
+    if (upper.rmse > limit || lower.rmse > limit) {
+      continue;
+    }
+    
+    // A line is flat if it moves less than the tolerance over the formation
+    double upperMove = upper.slope * (tEnd - tStart);
+    double lowerMove = lower.slope * (tEnd - tStart);
+    bool upperFlat   = std::fabs(upperMove) <= limit;
+    bool lowerFlat   = std::fabs(lowerMove) <= limit;
+    
+    std::string name;
+    bool bullish;
+    if (upperFlat && lowerMove > limit) {
+      name    = "ATRI";          // ascending: flat resistance, rising lows
+      bullish = true;
+    } else if (lowerFlat && upperMove < -limit) {
+      name    = "DTRI";          // descending: flat support, falling highs
+      bullish = false;
+    } else if (upperMove < -limit && lowerMove > limit) {
+      name    = "STRI";          // symmetric: breakout in the direction of the move into the triangle
+      bullish = firstIsHigh;
+    } else {
+      continue;
+    }
+    
+    setTrendlinePoints(series, i, firstHigh, lastHigh, firstLow, lastLow, upper, lower, outPattern);
+    outPattern.patternName = name;
+    
+    // Breakout through the fitted line on the original series, invalid beyond the last swing on the other side
+    const Trendline& line = bullish ? upper : lower;
+    setBreakoutLine(tStart, line.at(tStart), tEnd, line.at(tEnd),
+                    bullish ? prices[lastLow] : prices[lastHigh], !bullish, outPattern);
+    return true;
+  }
+  
+  return false;
+}
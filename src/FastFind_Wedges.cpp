@@ -0,0 +1,84 @@
+#include <vector>
+#include <cmath>
+#include <algorithm>
+#include "FastFind.hpp"
+
+/**
+ * @file FastFind_Wedges.cpp
+ * @brief Rising and falling wedge detection for the fastFind engine
+ *
+ * A wedge has an upper line through the swing highs and a lower line through the
+ * swing lows that point in the same direction and converge. Both lines come from the
+ * O(1) fits in Trendline.hpp. Candidates are pruned on the raw swing points first,
+ * then after the upper fit, so most windows never fit the second line.
+ */
+
+void WedgeDetector::prepare(const SeriesData& series) {
+  sums = TrendlineSums(series.pipTimes, series.pipPrices);
+  runs = alternatingRuns(series.pipPrices);
+}
+
+bool WedgeDetector::detect(const SeriesData& series, const PipWindow& window,
+                           PatternData& outPattern) const {
+  const NumericVector& times  = series.pipTimes;
+  const NumericVector& prices = series.pipPrices;
+  
+  int i     = window.i;
+  int first = i + 1;
+  
+  bool firstIsHigh = prices[first] > prices[i];
+  int maxSwings = std::min(2 * MAX_LINE_POINTS, runs[i] - 1);
+  
+  // Longest formation first
+  for (int swings = maxSwings; swings >= 2 * MIN_LINE_POINTS; --swings) {
+    int last      = first + swings - 1;
+    int firstHigh = firstIsHigh ? first : first + 1;
+    int firstLow  = firstIsHigh ? first + 1 : first;
+    int lastHigh  = firstHigh + 2 * ((last - firstHigh) / 2);
+    int lastLow   = firstLow  + 2 * ((last - firstLow)  / 2);
+    
+    // Highs and lows have to move in the same direction
+    double highMove = prices[lastHigh] - prices[firstHigh];
+    double lowMove  = prices[lastLow]  - prices[firstLow];
+    if (highMove * lowMove <= 0) {
+      continue;
+    }
+    bool rising = highMove > 0;
+    
+    double tStart = times[first];
+    double tEnd   = times[last];
+    double limit  = tolerance * std::fabs(prices[first]);
+    
+    // Upper line first, it has to slope clearly in the wedge's direction
+    Trendline upper = sums.fit(firstHigh, (lastHigh - firstHigh) / 2 + 1);
+    double upperMove = upper.slope * (tEnd - tStart);
+    if ((rising ? upperMove : -upperMove) <= limit || upper.rmse > limit) {
+      continue;
+    }
+    
+    Trendline lower = sums.fit(firstLow, (lastLow - firstLow) / 2 + 1);
+    double lowerMove = lower.slope * (tEnd - tStart);
+    if ((rising ? lowerMove : -lowerMove) <= limit || lower.rmse > limit) {
+      continue;
+    }
+    
+    // Converging, the apex lies after the last swing point
+    double gapStart = upper.at(tStart) - lower.at(tStart);
+    double gapEnd   = upper.at(tEnd)   - lower.at(tEnd);
+    if (gapEnd <= 0 || gapEnd >= gapStart) {
+      continue;
+    }
+    
+    setTrendlinePoints(series, i, firstHigh, lastHigh, firstLow, lastLow, upper, lower, outPattern);
+    outPattern.patternName = rising ? "RWEDGE" : "FWEDGE";
+    
+    // Wedges break against their direction: rising ones below the lower line, falling ones
+    // above the upper line. Passing the last swing on the other side invalidates them
+    const Trendline& line = rising ? lower : upper;
+    setBreakoutLine(tStart, line.at(tStart), tEnd, line.at(tEnd),
+                    rising ? prices[lastHigh] : prices[lastLow], rising, outPattern);
+    return true;
+  }
+  
+  return false;
+}
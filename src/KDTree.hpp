@@ -0,0 +1,138 @@
+#ifndef KDTree_hpp
+#define KDTree_hpp
+
+#include <vector>
+#include <queue>
+#include <numeric>
+#include <algorithm>
+#include <utility>
+
+/**
+ * @file KDTree.hpp
+ * @brief k-d tree for k-nearest-neighbour queries in a few dimensions
+ *
+ * Built once in O(n log n): every node splits its points at the median of the dimension
+ * with the largest spread, down to small leaves. A query descends to the nearer child
+ * first and visits the other one only if the splitting plane is closer than the k-th
+ * neighbour found so far, which makes it about O(log n) for low dimensions.
+ */
+
+class KDTree {
+public:
+  KDTree() {}
+
+  // points holds n points of dim coordinates each, point after point
+  KDTree(const std::vector<double>& points, int dim) : points(points), dim(dim) {
+    int n = dim > 0 ? points.size() / dim : 0;
+    order.resize(n);
+    std::iota(order.begin(), order.end(), 0);
+    if (n > 0) {
+      build(0, n);
+    }
+  }
+
+  int size() const {
+    return order.size();
+  }
+
+  // The k nearest points of query (dim coordinates), closest first, with their squared
+  // Euclidean distances
+  void nearest(const double* query, int k, std::vector<int>& idx, std::vector<double>& distance) const {
+    std::priority_queue<std::pair<double, int>> best;
+    if (!nodes.empty() && k > 0) {
+      search(0, query, k, best);
+    }
+    idx.resize(best.size());
+    distance.resize(best.size());
+    for (int j = best.size() - 1; j >= 0; --j) {
+      distance[j] = best.top().first;
+      idx[j]      = best.top().second;
+      best.pop();
+    }
+  }
+
+private:
+  // Points of a node: order[first..last-1]. Inner nodes split at value in splitDim
+  struct Node {
+    int first, last;
+    int splitDim;
+    double value;
+    int left, right;
+  };
+
+  static const int LEAF_SIZE = 8;
+
+  std::vector<double> points;
+  int dim = 0;
+  std::vector<int> order;
+  std::vector<Node> nodes;
+
+  int build(int first, int last) {
+    int id = nodes.size();
+    nodes.push_back({first, last, -1, 0, -1, -1});
+    if (last - first <= LEAF_SIZE) {
+      return id;
+    }
+
+    int splitDim = 0;
+    double widest = -1;
+    for (int d = 0; d < dim; ++d) {
+      double low = points[order[first] * dim + d], high = low;
+      for (int j = first + 1; j < last; ++j) {
+        low  = std::min(low,  points[order[j] * dim + d]);
+        high = std::max(high, points[order[j] * dim + d]);
+      }
+      if (high - low > widest) {
+        widest = high - low;
+        splitDim = d;
+      }
+    }
+    // All points equal, nothing to split
+    if (widest <= 0) {
+      return id;
+    }
+
+    int middle = (first + last) / 2;
+    std::nth_element(order.begin() + first, order.begin() + middle, order.begin() + last,
+                     [&](int a, int b) { return points[a * dim + splitDim] < points[b * dim + splitDim]; });
+    double value = points[order[middle] * dim + splitDim];
+
+    int left  = build(first, middle);
+    int right = build(middle, last);
+    nodes[id].splitDim = splitDim;
+    nodes[id].value    = value;
+    nodes[id].left     = left;
+    nodes[id].right    = right;
+    return id;
+  }
+
+  void search(int id, const double* query, int k, std::priority_queue<std::pair<double, int>>& best) const {
+    const Node& node = nodes[id];
+    if (node.splitDim < 0) {
+      for (int j = node.first; j < node.last; ++j) {
+        const double* p = points.data() + order[j] * dim;
+        double distance = 0;
+        for (int d = 0; d < dim; ++d) {
+          distance += (p[d] - query[d]) * (p[d] - query[d]);
+        }
+        if ((int)best.size() < k) {
+          best.push({distance, order[j]});
+        } else if (distance < best.top().first) {
+          best.pop();
+          best.push({distance, order[j]});
+        }
+      }
+      return;
+    }
+
+    double offset = query[node.splitDim] - node.value;
+    int nearer  = offset < 0 ? node.left  : node.right;
+    int farther = offset < 0 ? node.right : node.left;
+    search(nearer, query, k, best);
+    if ((int)best.size() < k || offset * offset < best.top().first) {
+      search(farther, query, k, best);
+    }
+  }
+};
+
+#endif
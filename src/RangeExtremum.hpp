@@ -0,0 +1,136 @@
+#ifndef RangeExtremum_hpp
+#define RangeExtremum_hpp
+
+#include <vector>
+#include <algorithm>
+
+/**
+ * @file RangeExtremum.hpp
+ * @brief Range-maximum and range-minimum index (sparse table)
+ *
+ * Built once in O(n log n). Afterwards the max/min of any index range is O(1) and
+ * the first index after a position that crosses a price level is O(log n). The first
+ * crossing of a sloped line skips blocks of the table and is O(log n) per near miss.
+ */
+
+class RangeExtremum {
+public:
+  RangeExtremum() {}
+
+  template <typename Values>
+  explicit RangeExtremum(const Values& values) {
+    n = values.size();
+    int levels = 1;
+    while ((1 << levels) <= n) {
+      ++levels;
+    }
+    maxTable.resize(levels);
+    minTable.resize(levels);
+    maxTable[0].assign(values.begin(), values.end());
+    minTable[0].assign(values.begin(), values.end());
+    for (int k = 1; k < levels; ++k) {
+      int blocks = n - (1 << k) + 1;
+      int half   = 1 << (k - 1);
+      maxTable[k].resize(blocks);
+      minTable[k].resize(blocks);
+      for (int j = 0; j < blocks; ++j) {
+        maxTable[k][j] = std::max(maxTable[k-1][j], maxTable[k-1][j+half]);
+        minTable[k][j] = std::min(minTable[k-1][j], minTable[k-1][j+half]);
+      }
+    }
+  }
+
+  int size() const {
+    return n;
+  }
+
+  // Maximum of the values first..last (inclusive)
+  double max(int first, int last) const {
+    int k = level(last - first + 1);
+    return std::max(maxTable[k][first], maxTable[k][last - (1 << k) + 1]);
+  }
+
+  // Minimum of the values first..last (inclusive)
+  double min(int first, int last) const {
+    int k = level(last - first + 1);
+    return std::min(minTable[k][first], minTable[k][last - (1 << k) + 1]);
+  }
+
+  // First index >= from whose value is above level, -1 if there is none
+  int firstAbove(int from, double level) const {
+    int pos = from;
+    for (int k = (int)maxTable.size() - 1; k >= 0; --k) {
+      if (pos + (1 << k) <= n && maxTable[k][pos] <= level) {
+        pos += 1 << k;
+      }
+    }
+    return pos < n ? pos : -1;
+  }
+
+  // First index >= from whose value is below level, -1 if there is none
+  int firstBelow(int from, double level) const {
+    int pos = from;
+    for (int k = (int)minTable.size() - 1; k >= 0; --k) {
+      if (pos + (1 << k) <= n && minTable[k][pos] >= level) {
+        pos += 1 << k;
+      }
+    }
+    return pos < n ? pos : -1;
+  }
+
+  // First index >= from whose value is below the line intercept + slope * x[index],
+  // -1 if there is none. x has to be increasing
+  template <typename Positions>
+  int firstBelowLine(int from, const Positions& x, double slope, double intercept) const {
+    return firstCrossing(minTable, from, x, slope, intercept, true);
+  }
+
+  // First index >= from whose value is above the line intercept + slope * x[index],
+  // -1 if there is none. x has to be increasing
+  template <typename Positions>
+  int firstAboveLine(int from, const Positions& x, double slope, double intercept) const {
+    return firstCrossing(maxTable, from, x, slope, intercept, false);
+  }
+
+private:
+  int n = 0;
+  std::vector<std::vector<double>> maxTable;
+  std::vector<std::vector<double>> minTable;
+
+  // A block is skipped as a whole if its min (max) stays on the right side of the line at
+  // both block ends, the line being monotone in between. The block size grows after a skip
+  // and shrinks before a block that might hold the crossing
+  template <typename Positions>
+  int firstCrossing(const std::vector<std::vector<double>>& table, int from, const Positions& x,
+                    double slope, double intercept, bool below) const {
+    int top = (int)table.size() - 1;
+    int k = 0;
+    int pos = from;
+    while (pos < n) {
+      k = std::min(k, level(n - pos));
+      for (;; --k) {
+        int last = pos + (1 << k) - 1;
+        double lineFirst = intercept + slope * x[pos];
+        double lineLast  = intercept + slope * x[last];
+        bool clear = below ? table[k][pos] >= std::max(lineFirst, lineLast)
+                           : table[k][pos] <= std::min(lineFirst, lineLast);
+        if (clear) {
+          break;
+        }
+        if (k == 0) {
+          return pos;
+        }
+      }
+      pos += 1 << k;
+      k = std::min(k + 1, top);
+    }
+    return -1;
+  }
+
+  // floor(log2(length))
+  static int level(int length) {
+    return 31 - __builtin_clz((unsigned int)length);
+  }
+};
+
+#endif
@@ -11,15 +11,22 @@ Rcpp::Rostream<false>& Rcpp::Rcerr = Rcpp::Rcpp_cerr_get();
 #endif
 
 // fastFind
-Rcpp::DataFrame fastFind(IntegerVector PrePro_indexFilter, NumericVector Original_times, NumericVector Original_prices);
-RcppExport SEXP _ChartPatterns_fastFind(SEXP PrePro_indexFilterSEXP, SEXP Original_timesSEXP, SEXP Original_pricesSEXP) {
+Rcpp::DataFrame fastFind(IntegerVector PrePro_indexFilter, NumericVector Original_times, NumericVector Original_prices, double peakTolerance, double lineTolerance, int maxGap, double shsTolerance, Rcpp::Nullable<IntegerVector> sessions, bool nonMaxSuppression, double minQuality);
+RcppExport SEXP _ChartPatterns_fastFind(SEXP PrePro_indexFilterSEXP, SEXP Original_timesSEXP, SEXP Original_pricesSEXP, SEXP peakToleranceSEXP, SEXP lineToleranceSEXP, SEXP maxGapSEXP, SEXP shsToleranceSEXP, SEXP sessionsSEXP, SEXP nonMaxSuppressionSEXP, SEXP minQualitySEXP) {
 BEGIN_RCPP
     Rcpp::RObject rcpp_result_gen;
     Rcpp::RNGScope rcpp_rngScope_gen;
     Rcpp::traits::input_parameter< IntegerVector >::type PrePro_indexFilter(PrePro_indexFilterSEXP);
     Rcpp::traits::input_parameter< NumericVector >::type Original_times(Original_timesSEXP);
     Rcpp::traits::input_parameter< NumericVector >::type Original_prices(Original_pricesSEXP);
-    rcpp_result_gen = Rcpp::wrap(fastFind(PrePro_indexFilter, Original_times, Original_prices));
+    Rcpp::traits::input_parameter< double >::type peakTolerance(peakToleranceSEXP);
+    Rcpp::traits::input_parameter< double >::type lineTolerance(lineToleranceSEXP);
+    Rcpp::traits::input_parameter< int >::type maxGap(maxGapSEXP);
+    Rcpp::traits::input_parameter< double >::type shsTolerance(shsToleranceSEXP);
+    Rcpp::traits::input_parameter< Rcpp::Nullable<IntegerVector> >::type sessions(sessionsSEXP);
+    Rcpp::traits::input_parameter< bool >::type nonMaxSuppression(nonMaxSuppressionSEXP);
+    Rcpp::traits::input_parameter< double >::type minQuality(minQualitySEXP);
+    rcpp_result_gen = Rcpp::wrap(fastFind(PrePro_indexFilter, Original_times, Original_prices, peakTolerance, lineTolerance, maxGap, shsTolerance, sessions, nonMaxSuppression, minQuality));
     return rcpp_result_gen;
 END_RCPP
 }
@@ -36,6 +43,110 @@ BEGIN_RCPP
     return rcpp_result_gen;
 END_RCPP
 }
+// analogForecast
+Rcpp::List analogForecast(Rcpp::List history, Rcpp::List patterns, int k);
+RcppExport SEXP _ChartPatterns_analogForecast(SEXP historySEXP, SEXP patternsSEXP, SEXP kSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< Rcpp::List >::type history(historySEXP);
+    Rcpp::traits::input_parameter< Rcpp::List >::type patterns(patternsSEXP);
+    Rcpp::traits::input_parameter< int >::type k(kSEXP);
+    rcpp_result_gen = Rcpp::wrap(analogForecast(history, patterns, k));
+    return rcpp_result_gen;
+END_RCPP
+}
+// clusterPatterns
+Rcpp::List clusterPatterns(Rcpp::List patterns, int k, int batchSize, int maxIterations);
+RcppExport SEXP _ChartPatterns_clusterPatterns(SEXP patternsSEXP, SEXP kSEXP, SEXP batchSizeSEXP, SEXP maxIterationsSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< Rcpp::List >::type patterns(patternsSEXP);
+    Rcpp::traits::input_parameter< int >::type k(kSEXP);
+    Rcpp::traits::input_parameter< int >::type batchSize(batchSizeSEXP);
+    Rcpp::traits::input_parameter< int >::type maxIterations(maxIterationsSEXP);
+    rcpp_result_gen = Rcpp::wrap(clusterPatterns(patterns, k, batchSize, maxIterations));
+    return rcpp_result_gen;
+END_RCPP
+}
+// dtwSearch
+Rcpp::DataFrame dtwSearch(Rcpp::List Original_times, Rcpp::List Original_prices, NumericVector query, int topK, double warpingWindow);
+RcppExport SEXP _ChartPatterns_dtwSearch(SEXP Original_timesSEXP, SEXP Original_pricesSEXP, SEXP querySEXP, SEXP topKSEXP, SEXP warpingWindowSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< Rcpp::List >::type Original_times(Original_timesSEXP);
+    Rcpp::traits::input_parameter< Rcpp::List >::type Original_prices(Original_pricesSEXP);
+    Rcpp::traits::input_parameter< NumericVector >::type query(querySEXP);
+    Rcpp::traits::input_parameter< int >::type topK(topKSEXP);
+    Rcpp::traits::input_parameter< double >::type warpingWindow(warpingWindowSEXP);
+    rcpp_result_gen = Rcpp::wrap(dtwSearch(Original_times, Original_prices, query, topK, warpingWindow));
+    return rcpp_result_gen;
+END_RCPP
+}
+// findGaps
+Rcpp::List findGaps(NumericVector Original_times, NumericVector Original_prices, Rcpp::Nullable<NumericVector> high, Rcpp::Nullable<NumericVector> low, double minGap, int maxIslandBars, int volatilityWindow);
+RcppExport SEXP _ChartPatterns_findGaps(SEXP Original_timesSEXP, SEXP Original_pricesSEXP, SEXP highSEXP, SEXP lowSEXP, SEXP minGapSEXP, SEXP maxIslandBarsSEXP, SEXP volatilityWindowSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< NumericVector >::type Original_times(Original_timesSEXP);
+    Rcpp::traits::input_parameter< NumericVector >::type Original_prices(Original_pricesSEXP);
+    Rcpp::traits::input_parameter< Rcpp::Nullable<NumericVector> >::type high(highSEXP);
+    Rcpp::traits::input_parameter< Rcpp::Nullable<NumericVector> >::type low(lowSEXP);
+    Rcpp::traits::input_parameter< double >::type minGap(minGapSEXP);
+    Rcpp::traits::input_parameter< int >::type maxIslandBars(maxIslandBarsSEXP);
+    Rcpp::traits::input_parameter< int >::type volatilityWindow(volatilityWindowSEXP);
+    rcpp_result_gen = Rcpp::wrap(findGaps(Original_times, Original_prices, high, low, minGap, maxIslandBars, volatilityWindow));
+    return rcpp_result_gen;
+END_RCPP
+}
+// findLevels
+Rcpp::DataFrame findLevels(IntegerVector PrePro_indexFilter, NumericVector Original_times, NumericVector Original_prices, double levelTolerance, int minTouches);
+RcppExport SEXP _ChartPatterns_findLevels(SEXP PrePro_indexFilterSEXP, SEXP Original_timesSEXP, SEXP Original_pricesSEXP, SEXP levelToleranceSEXP, SEXP minTouchesSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< IntegerVector >::type PrePro_indexFilter(PrePro_indexFilterSEXP);
+    Rcpp::traits::input_parameter< NumericVector >::type Original_times(Original_timesSEXP);
+    Rcpp::traits::input_parameter< NumericVector >::type Original_prices(Original_pricesSEXP);
+    Rcpp::traits::input_parameter< double >::type levelTolerance(levelToleranceSEXP);
+    Rcpp::traits::input_parameter< int >::type minTouches(minTouchesSEXP);
+    rcpp_result_gen = Rcpp::wrap(findLevels(PrePro_indexFilter, Original_times, Original_prices, levelTolerance, minTouches));
+    return rcpp_result_gen;
+END_RCPP
+}
+// nearestLevels
+Rcpp::DataFrame nearestLevels(NumericVector level, NumericVector confirmedTime, NumericVector prices, NumericVector times);
+RcppExport SEXP _ChartPatterns_nearestLevels(SEXP levelSEXP, SEXP confirmedTimeSEXP, SEXP pricesSEXP, SEXP timesSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< NumericVector >::type level(levelSEXP);
+    Rcpp::traits::input_parameter< NumericVector >::type confirmedTime(confirmedTimeSEXP);
+    Rcpp::traits::input_parameter< NumericVector >::type prices(pricesSEXP);
+    Rcpp::traits::input_parameter< NumericVector >::type times(timesSEXP);
+    rcpp_result_gen = Rcpp::wrap(nearestLevels(level, confirmedTime, prices, times));
+    return rcpp_result_gen;
+END_RCPP
+}
+// fitSHS
+Rcpp::DataFrame fitSHS(IntegerVector PrePro_indexFilter, NumericVector Original_times, NumericVector Original_prices, int regionSize, int maxInstances, double minScore);
+RcppExport SEXP _ChartPatterns_fitSHS(SEXP PrePro_indexFilterSEXP, SEXP Original_timesSEXP, SEXP Original_pricesSEXP, SEXP regionSizeSEXP, SEXP maxInstancesSEXP, SEXP minScoreSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< IntegerVector >::type PrePro_indexFilter(PrePro_indexFilterSEXP);
+    Rcpp::traits::input_parameter< NumericVector >::type Original_times(Original_timesSEXP);
+    Rcpp::traits::input_parameter< NumericVector >::type Original_prices(Original_pricesSEXP);
+    Rcpp::traits::input_parameter< int >::type regionSize(regionSizeSEXP);
+    Rcpp::traits::input_parameter< int >::type maxInstances(maxInstancesSEXP);
+    Rcpp::traits::input_parameter< double >::type minScore(minScoreSEXP);
+    rcpp_result_gen = Rcpp::wrap(fitSHS(PrePro_indexFilter, Original_times, Original_prices, regionSize, maxInstances, minScore));
+    return rcpp_result_gen;
+END_RCPP
+}
 // getSlope
 double getSlope(double x1, double x2, double y1, double y2);
 RcppExport SEXP _ChartPatterns_getSlope(SEXP x1SEXP, SEXP x2SEXP, SEXP y1SEXP, SEXP y2SEXP) {
@@ -65,12 +176,135 @@ BEGIN_RCPP
     return rcpp_result_gen;
 END_RCPP
 }
+// matrixProfile
+Rcpp::List matrixProfile(NumericVector Original_times, NumericVector Original_prices, int windowLength, int topK);
+RcppExport SEXP _ChartPatterns_matrixProfile(SEXP Original_timesSEXP, SEXP Original_pricesSEXP, SEXP windowLengthSEXP, SEXP topKSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< NumericVector >::type Original_times(Original_timesSEXP);
+    Rcpp::traits::input_parameter< NumericVector >::type Original_prices(Original_pricesSEXP);
+    Rcpp::traits::input_parameter< int >::type windowLength(windowLengthSEXP);
+    Rcpp::traits::input_parameter< int >::type topK(topKSEXP);
+    rcpp_result_gen = Rcpp::wrap(matrixProfile(Original_times, Original_prices, windowLength, topK));
+    return rcpp_result_gen;
+END_RCPP
+}
+// buildSaxIndex
+Rcpp::List buildSaxIndex(Rcpp::List PrePro_indexFilters, Rcpp::List Original_prices, int windowLength, int alphabetSize);
+RcppExport SEXP _ChartPatterns_buildSaxIndex(SEXP PrePro_indexFiltersSEXP, SEXP Original_pricesSEXP, SEXP windowLengthSEXP, SEXP alphabetSizeSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< Rcpp::List >::type PrePro_indexFilters(PrePro_indexFiltersSEXP);
+    Rcpp::traits::input_parameter< Rcpp::List >::type Original_prices(Original_pricesSEXP);
+    Rcpp::traits::input_parameter< int >::type windowLength(windowLengthSEXP);
+    Rcpp::traits::input_parameter< int >::type alphabetSize(alphabetSizeSEXP);
+    rcpp_result_gen = Rcpp::wrap(buildSaxIndex(PrePro_indexFilters, Original_prices, windowLength, alphabetSize));
+    return rcpp_result_gen;
+END_RCPP
+}
+// querySaxIndex
+Rcpp::DataFrame querySaxIndex(Rcpp::List index, NumericVector shape, std::string patternName, Rcpp::List PrePro_indexFilters, Rcpp::List Original_times, Rcpp::List Original_prices, int symbolTolerance, double peakTolerance, double lineTolerance);
+RcppExport SEXP _ChartPatterns_querySaxIndex(SEXP indexSEXP, SEXP shapeSEXP, SEXP patternNameSEXP, SEXP PrePro_indexFiltersSEXP, SEXP Original_timesSEXP, SEXP Original_pricesSEXP, SEXP symbolToleranceSEXP, SEXP peakToleranceSEXP, SEXP lineToleranceSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< Rcpp::List >::type index(indexSEXP);
+    Rcpp::traits::input_parameter< NumericVector >::type shape(shapeSEXP);
+    Rcpp::traits::input_parameter< std::string >::type patternName(patternNameSEXP);
+    Rcpp::traits::input_parameter< Rcpp::List >::type PrePro_indexFilters(PrePro_indexFiltersSEXP);
+    Rcpp::traits::input_parameter< Rcpp::List >::type Original_times(Original_timesSEXP);
+    Rcpp::traits::input_parameter< Rcpp::List >::type Original_prices(Original_pricesSEXP);
+    Rcpp::traits::input_parameter< int >::type symbolTolerance(symbolToleranceSEXP);
+    Rcpp::traits::input_parameter< double >::type peakTolerance(peakToleranceSEXP);
+    Rcpp::traits::input_parameter< double >::type lineTolerance(lineToleranceSEXP);
+    rcpp_result_gen = Rcpp::wrap(querySaxIndex(index, shape, patternName, PrePro_indexFilters, Original_times, Original_prices, symbolTolerance, peakTolerance, lineTolerance));
+    return rcpp_result_gen;
+END_RCPP
+}
+// scanCandles
+IntegerVector scanCandles(NumericVector open, NumericVector high, NumericVector low, NumericVector close, int mask);
+RcppExport SEXP _ChartPatterns_scanCandles(SEXP openSEXP, SEXP highSEXP, SEXP lowSEXP, SEXP closeSEXP, SEXP maskSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< NumericVector >::type open(openSEXP);
+    Rcpp::traits::input_parameter< NumericVector >::type high(highSEXP);
+    Rcpp::traits::input_parameter< NumericVector >::type low(lowSEXP);
+    Rcpp::traits::input_parameter< NumericVector >::type close(closeSEXP);
+    Rcpp::traits::input_parameter< int >::type mask(maskSEXP);
+    rcpp_result_gen = Rcpp::wrap(scanCandles(open, high, low, close, mask));
+    return rcpp_result_gen;
+END_RCPP
+}
+// confirmBreakouts
+LogicalVector confirmBreakouts(IntegerVector candles, IntegerVector breakoutIdx, LogicalVector bearish, int bullishMask, int bearishMask, int lookback);
+RcppExport SEXP _ChartPatterns_confirmBreakouts(SEXP candlesSEXP, SEXP breakoutIdxSEXP, SEXP bearishSEXP, SEXP bullishMaskSEXP, SEXP bearishMaskSEXP, SEXP lookbackSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< IntegerVector >::type candles(candlesSEXP);
+    Rcpp::traits::input_parameter< IntegerVector >::type breakoutIdx(breakoutIdxSEXP);
+    Rcpp::traits::input_parameter< LogicalVector >::type bearish(bearishSEXP);
+    Rcpp::traits::input_parameter< int >::type bullishMask(bullishMaskSEXP);
+    Rcpp::traits::input_parameter< int >::type bearishMask(bearishMaskSEXP);
+    Rcpp::traits::input_parameter< int >::type lookback(lookbackSEXP);
+    rcpp_result_gen = Rcpp::wrap(confirmBreakouts(candles, breakoutIdx, bearish, bullishMask, bearishMask, lookback));
+    return rcpp_result_gen;
+END_RCPP
+}
+// suppressOverlaps
+LogicalVector suppressOverlaps(std::vector<std::string> PatternName, std::vector<double> spanStart, std::vector<double> spanEnd, Rcpp::Nullable<NumericVector> score);
+RcppExport SEXP _ChartPatterns_suppressOverlaps(SEXP PatternNameSEXP, SEXP spanStartSEXP, SEXP spanEndSEXP, SEXP scoreSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< std::vector<std::string> >::type PatternName(PatternNameSEXP);
+    Rcpp::traits::input_parameter< std::vector<double> >::type spanStart(spanStartSEXP);
+    Rcpp::traits::input_parameter< std::vector<double> >::type spanEnd(spanEndSEXP);
+    Rcpp::traits::input_parameter< Rcpp::Nullable<NumericVector> >::type score(scoreSEXP);
+    rcpp_result_gen = Rcpp::wrap(suppressOverlaps(PatternName, spanStart, spanEnd, score));
+    return rcpp_result_gen;
+END_RCPP
+}
+// tripleBarrier
+Rcpp::DataFrame tripleBarrier(NumericVector Original_prices, IntegerVector eventIdx, double upper, double lower, int maxHolding, int volatilityWindow, Rcpp::Nullable<LogicalVector> bearish);
+RcppExport SEXP _ChartPatterns_tripleBarrier(SEXP Original_pricesSEXP, SEXP eventIdxSEXP, SEXP upperSEXP, SEXP lowerSEXP, SEXP maxHoldingSEXP, SEXP volatilityWindowSEXP, SEXP bearishSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< NumericVector >::type Original_prices(Original_pricesSEXP);
+    Rcpp::traits::input_parameter< IntegerVector >::type eventIdx(eventIdxSEXP);
+    Rcpp::traits::input_parameter< double >::type upper(upperSEXP);
+    Rcpp::traits::input_parameter< double >::type lower(lowerSEXP);
+    Rcpp::traits::input_parameter< int >::type maxHolding(maxHoldingSEXP);
+    Rcpp::traits::input_parameter< int >::type volatilityWindow(volatilityWindowSEXP);
+    Rcpp::traits::input_parameter< Rcpp::Nullable<LogicalVector> >::type bearish(bearishSEXP);
+    rcpp_result_gen = Rcpp::wrap(tripleBarrier(Original_prices, eventIdx, upper, lower, maxHolding, volatilityWindow, bearish));
+    return rcpp_result_gen;
+END_RCPP
+}
 
 static const R_CallMethodDef CallEntries[] = {
-    {"_ChartPatterns_fastFind", (DL_FUNC) &_ChartPatterns_fastFind, 3},
+    {"_ChartPatterns_fastFind", (DL_FUNC) &_ChartPatterns_fastFind, 10},
     {"_ChartPatterns_fastFind_chaosRegin", (DL_FUNC) &_ChartPatterns_fastFind_chaosRegin, 3},
+    {"_ChartPatterns_analogForecast", (DL_FUNC) &_ChartPatterns_analogForecast, 3},
+    {"_ChartPatterns_clusterPatterns", (DL_FUNC) &_ChartPatterns_clusterPatterns, 4},
+    {"_ChartPatterns_dtwSearch", (DL_FUNC) &_ChartPatterns_dtwSearch, 5},
+    {"_ChartPatterns_findGaps", (DL_FUNC) &_ChartPatterns_findGaps, 7},
+    {"_ChartPatterns_findLevels", (DL_FUNC) &_ChartPatterns_findLevels, 5},
+    {"_ChartPatterns_nearestLevels", (DL_FUNC) &_ChartPatterns_nearestLevels, 4},
+    {"_ChartPatterns_fitSHS", (DL_FUNC) &_ChartPatterns_fitSHS, 6},
     {"_ChartPatterns_getSlope", (DL_FUNC) &_ChartPatterns_getSlope, 4},
     {"_ChartPatterns_linearInterpolation", (DL_FUNC) &_ChartPatterns_linearInterpolation, 5},
+    {"_ChartPatterns_matrixProfile", (DL_FUNC) &_ChartPatterns_matrixProfile, 4},
+    {"_ChartPatterns_buildSaxIndex", (DL_FUNC) &_ChartPatterns_buildSaxIndex, 4},
+    {"_ChartPatterns_querySaxIndex", (DL_FUNC) &_ChartPatterns_querySaxIndex, 9},
+    {"_ChartPatterns_scanCandles", (DL_FUNC) &_ChartPatterns_scanCandles, 5},
+    {"_ChartPatterns_confirmBreakouts", (DL_FUNC) &_ChartPatterns_confirmBreakouts, 6},
+    {"_ChartPatterns_suppressOverlaps", (DL_FUNC) &_ChartPatterns_suppressOverlaps, 4},
+    {"_ChartPatterns_tripleBarrier", (DL_FUNC) &_ChartPatterns_tripleBarrier, 7},
     {NULL, NULL, 0}
 };
 
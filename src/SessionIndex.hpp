@@ -0,0 +1,50 @@
+#ifndef SessionIndex_hpp
+#define SessionIndex_hpp
+
+#include <vector>
+
+/**
+ * @file SessionIndex.hpp
+ * @brief Trading sessions of a bar series for horizons in sessions instead of calendar time
+ *
+ * The session numbers of the bars (non-decreasing, e.g. a running count of trading days,
+ * or the bar index for horizons in bars) are ranked densely once in O(n). Afterwards
+ * the bar that closes the session h sessions after a given bar is an O(1) lookup, and
+ * weekends or holidays without bars do not count.
+ */
+
+class SessionIndex {
+public:
+  SessionIndex() {}
+
+  // sessionNumbers have to be non-decreasing and not NA, fastFind checks them
+  template <typename Sessions>
+  explicit SessionIndex(const Sessions& sessionNumbers) {
+    int n = sessionNumbers.size();
+    session.resize(n);
+    for (int j = 0; j < n; ++j) {
+      if (j == 0 || sessionNumbers[j] != sessionNumbers[j-1]) {
+        lastBar.push_back(j);
+      }
+      session[j] = lastBar.size() - 1;
+      lastBar.back() = j;
+    }
+  }
+
+  // Sessions from the session of bar from to the one of bar to
+  int distance(int from, int to) const {
+    return session[to] - session[from];
+  }
+
+  // Last bar of the session h sessions after the session of bar, -1 beyond the series
+  int barAfter(int bar, int h) const {
+    int target = session[bar] + h;
+    return target < (int)lastBar.size() ? lastBar[target] : -1;
+  }
+
+private:
+  std::vector<int> session;   // dense session rank of every bar
+  std::vector<int> lastBar;   // last bar of every session
+};
+
+#endif
@@ -0,0 +1,104 @@
+#ifndef Trendline_hpp
+#define Trendline_hpp
+
+#include <vector>
+#include <cmath>
+#include <algorithm>
+#include "cppHeader.hpp"
+
+/**
+ * @file Trendline.hpp
+ * @brief Least-squares trendlines through swing highs or swing lows of the PIP series
+ *
+ * Swing highs and lows alternate in the PIP series, so the points of one line are
+ * every second PIP. The regression sums are kept cumulative with stride 2: the sums
+ * of any run of swing points are the difference of two entries and each fit is O(1)
+ * no matter how far the window has slid.
+ */
+
+// Swing points per trendline
+const int MIN_LINE_POINTS = 2;
+const int MAX_LINE_POINTS = 5;
+
+// Least-squares line y = intercept + slope * x
+struct Trendline {
+  double slope;
+  double intercept;
+  double rmse;      // root mean squared residual of the fitted swing points
+
+  double at(double x) const {
+    return intercept + slope * x;
+  }
+};
+
+// Number of alternating PIPs (high, low, high, ...) starting at every position
+inline std::vector<int> alternatingRuns(const NumericVector& prices) {
+  int n = prices.size();
+  std::vector<int> runs(n, 1);
+  if (n > 1) {
+    runs[n-2] = 2;
+  }
+  for (int j = n - 3; j >= 0; --j) {
+    bool alternates = (prices[j+1] - prices[j]) * (prices[j+2] - prices[j+1]) < 0;
+    runs[j] = alternates ? runs[j+1] + 1 : 2;
+  }
+  return runs;
+}
+
+class TrendlineSums {
+public:
+  TrendlineSums() {}
+
+  TrendlineSums(const NumericVector& x, const NumericVector& y) {
+    int n = x.size();
+    // Times are shifted to the first PIP to keep the sums well conditioned
+    origin = n > 0 ? x[0] : 0;
+    sx.assign(n, 0);
+    sy.assign(n, 0);
+    sxx.assign(n, 0);
+    sxy.assign(n, 0);
+    syy.assign(n, 0);
+    for (int j = 0; j < n; ++j) {
+      long double xj = x[j] - origin;
+      long double yj = y[j];
+      sx[j]  = xj      + (j > 1 ? sx[j-2]  : 0);
+      sy[j]  = yj      + (j > 1 ? sy[j-2]  : 0);
+      sxx[j] = xj * xj + (j > 1 ? sxx[j-2] : 0);
+      sxy[j] = xj * yj + (j > 1 ? sxy[j-2] : 0);
+      syy[j] = yj * yj + (j > 1 ? syy[j-2] : 0);
+    }
+  }
+
+  // Fits the line through the PIPs first, first+2, ..., first+2*(count-1)
+  Trendline fit(int first, int count) const {
+    int last = first + 2 * (count - 1);
+    long double n   = count;
+    long double Sx  = range(sx,  first, last);
+    long double Sy  = range(sy,  first, last);
+    long double Sxx = range(sxx, first, last);
+    long double Sxy = range(sxy, first, last);
+    long double Syy = range(syy, first, last);
+
+    Trendline line;
+    long double denominator = n * Sxx - Sx * Sx;
+    long double slope = denominator != 0 ? (n * Sxy - Sx * Sy) / denominator : 0;
+    long double intercept = (Sy - slope * Sx) / n;
+    // Residual sum of squares from the same sums
+    long double sse = Syy - intercept * Sy - slope * Sxy;
+
+    line.slope     = slope;
+    line.intercept = intercept - slope * origin;
+    line.rmse      = std::sqrt((double)std::max(sse / n, (long double)0));
+    return line;
+  }
+
+private:
+  double origin = 0;
+  std::vector<long double> sx, sy, sxx, sxy, syy;
+
+  static long double range(const std::vector<long double>& sums, int first, int last) {
+    return sums[last] - (first > 1 ? sums[first-2] : 0);
+  }
+};
+
+#endif
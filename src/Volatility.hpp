@@ -0,0 +1,55 @@
+#ifndef Volatility_hpp
+#define Volatility_hpp
+
+#include <vector>
+#include <cmath>
+#include <algorithm>
+
+/**
+ * @file Volatility.hpp
+ * @brief Local volatility of a price series from prefix sums
+ *
+ * Prefix sums of the price changes and their squares give the standard deviation of
+ * the price changes over any trailing window in O(1).
+ */
+
+// Trailing window (in observations) used when nothing else is given
+const int VOLATILITY_WINDOW = 20;
+
+class RollingVolatility {
+public:
+  RollingVolatility() {}
+
+  template <typename Values>
+  explicit RollingVolatility(const Values& prices) {
+    int n = prices.size();
+    sum.assign(n, 0);
+    sumSquares.assign(n, 0);
+    // Entry k holds the sums of the changes 1..k (change k = prices[k] - prices[k-1])
+    for (int k = 1; k < n; ++k) {
+      double change = prices[k] - prices[k-1];
+      sum[k]        = sum[k-1] + change;
+      sumSquares[k] = sumSquares[k-1] + change * change;
+    }
+  }
+
+  // Standard deviation of the price changes in the window of changes ending at index end.
+  // Shorter at the start of the series, 0 if there are less than two changes
+  double at(int end, int window = VOLATILITY_WINDOW) const {
+    int first = std::max(1, end - window + 1);
+    int count = end - first + 1;
+    if (count < 2) {
+      return 0;
+    }
+    double s  = sum[end] - sum[first-1];
+    double ss = sumSquares[end] - sumSquares[first-1];
+    double variance = (ss - s * s / count) / (count - 1);
+    return std::sqrt(std::max(variance, 0.0));
+  }
+
+private:
+  std::vector<double> sum;
+  std::vector<double> sumSquares;
+};
+
+#endif
@@ -0,0 +1,188 @@
+#include <vector>
+#include <string>
+#include <map>
+#include <cmath>
+#include <algorithm>
+#include "cppHeader.hpp"
+#include "KDTree.hpp"
+
+/**
+ * @file analogForecast.cpp
+ * @brief Empirical forecast of patterns from the returns of their nearest historical analogs
+ *
+ * Every pattern becomes a shape vector of its pattern points: times relative to the
+ * pattern duration and prices relative to the pattern range, both in [0, 1]. The history
+ * gets one k-d tree per pattern name and number of points, so a query only meets
+ * patterns of its own kind and is answered in about O(log n).
+ */
+
+const int RETURN_COLUMNS = 11;
+const char* const RETURN_NAMES[RETURN_COLUMNS] = {
+  "Rendite1V", "Rendite3V", "Rendite5V", "Rendite10V", "Rendite30V", "Rendite60V",
+  "relRendite13V", "relRendite12V", "relRendite1V", "relRendite2V", "relRendite4V"
+};
+
+// calculateReturns stores -1 for horizons that run past the end of the series
+const double MISSING_RETURN = -1;
+
+// Shape vectors of the patterns of a fastFind result: the relative times of the inner
+// points, then the relative prices of all points. Grouped by name and number of points,
+// patterns without a duration or price range get no vector and no group
+void patternShapes(const Rcpp::List& result, std::vector<std::string>& group,
+                   std::vector<std::vector<double>>& shape) {
+  Rcpp::DataFrame info     = result["patternInfo"];
+  Rcpp::DataFrame features = result["Features2"];
+  std::vector<std::string> names = info["PatternName"];
+  NumericVector times[6]  = {features["timeStamp0"], features["timeStamp1"], features["timeStamp2"],
+                             features["timeStamp3"], features["timeStamp4"], features["timeStamp5"]};
+  NumericVector prices[6] = {features["priceStamp0"], features["priceStamp1"], features["priceStamp2"],
+                             features["priceStamp3"], features["priceStamp4"], features["priceStamp5"]};
+
+  int n = names.size();
+  group.assign(n, "");
+  shape.assign(n, std::vector<double>());
+  for (int i = 0; i < n; ++i) {
+    // Unused pattern points are NA
+    int points = 0;
+    while (points < 6 && !NumericVector::is_na(times[points][i]) && !NumericVector::is_na(prices[points][i])) {
+      ++points;
+    }
+    if (points < 2) {
+      continue;
+    }
+    double duration = times[points-1][i] - times[0][i];
+    double low = prices[0][i], high = prices[0][i];
+    for (int k = 1; k < points; ++k) {
+      low  = std::min(low,  (double)prices[k][i]);
+      high = std::max(high, (double)prices[k][i]);
+    }
+    if (duration <= 0 || high <= low) {
+      continue;
+    }
+
+    // The first and last relative times are always 0 and 1
+    for (int k = 1; k < points - 1; ++k) {
+      shape[i].push_back((times[k][i] - times[0][i]) / duration);
+    }
+    for (int k = 0; k < points; ++k) {
+      shape[i].push_back((prices[k][i] - low) / (high - low));
+    }
+    group[i] = names[i] + "/" + std::to_string(points);
+  }
+}
+
+//' @name analogForecast
+//' @title analogForecast
+//' @description Forecasts patterns from their k most similar historical patterns of the same name. The shape of a pattern are its pattern points, times relative to the duration and prices relative to the range of the pattern. The history is put into one k-d tree per pattern name, so each query takes about O(log n) and the function is fast enough to run on every new detection.
+//' @param history fastFind result with the historical patterns, e.g. of many series bound together
+//' @param patterns fastFind result with the patterns to forecast
+//' @param k Number of neighbours
+//' @return Returns a list with forecast, one row per pattern with PatternName, the number of neighbours found, their mean distance and the mean of each Rendite and relRendite column over the neighbours that have a return at that horizon (NA if none has); and neighbours, one row per pattern and neighbour with pattern, neighbour (rows of patterns and history, one based), rank and distance
+//' @export
+// [[Rcpp::export]]
+Rcpp::List analogForecast(Rcpp::List history,
+                          Rcpp::List patterns,
+                          int k = 10
+){
+
+  if (k < 1) {
+    stop("k has to be positive.");
+  }
+
+  std::vector<std::string> historyGroup, queryGroup;
+  std::vector<std::vector<double>> historyShape, queryShape;
+  patternShapes(history, historyGroup, historyShape);
+  patternShapes(patterns, queryGroup, queryShape);
+
+  Rcpp::DataFrame historyReturns = history["Features21to40"];
+  std::vector<NumericVector> returns;
+  for (int c = 0; c < RETURN_COLUMNS; ++c) {
+    returns.push_back(historyReturns[RETURN_NAMES[c]]);
+  }
+
+  // One tree per group, tree points are mapped back to history rows
+  std::map<std::string, std::vector<int>> groupRows;
+  for (size_t i = 0; i < historyGroup.size(); ++i) {
+    if (!historyGroup[i].empty()) {
+      groupRows[historyGroup[i]].push_back(i);
+    }
+  }
+  std::map<std::string, KDTree> trees;
+  for (const auto& entry : groupRows) {
+    int dim = historyShape[entry.second[0]].size();
+    std::vector<double> points;
+    points.reserve(entry.second.size() * dim);
+    for (int row : entry.second) {
+      points.insert(points.end(), historyShape[row].begin(), historyShape[row].end());
+    }
+    trees.emplace(entry.first, KDTree(points, dim));
+  }
+
+  int n = queryGroup.size();
+  Rcpp::DataFrame queryInfo = patterns["patternInfo"];
+  std::vector<std::string> PatternName = queryInfo["PatternName"];
+  std::vector<int> neighbourCount(n, 0);
+  std::vector<double> meanDistance(n, NA_REAL);
+  std::vector<std::vector<double>> meanReturns(RETURN_COLUMNS, std::vector<double>(n, NA_REAL));
+  std::vector<int> neighbourPattern, neighbourRow, neighbourRank;
+  std::vector<double> neighbourDistance;
+
+  std::vector<int> idx;
+  std::vector<double> distance;
+  for (int i = 0; i < n; ++i) {
+    auto tree = trees.find(queryGroup[i]);
+    if (queryGroup[i].empty() || tree == trees.end()) {
+      continue;
+    }
+    tree->second.nearest(queryShape[i].data(), k, idx, distance);
+    const std::vector<int>& rows = groupRows[queryGroup[i]];
+
+    int found = idx.size();
+    double distanceSum = 0;
+    std::vector<double> returnSum(RETURN_COLUMNS, 0);
+    std::vector<int> returnCount(RETURN_COLUMNS, 0);
+    for (int j = 0; j < found; ++j) {
+      int row = rows[idx[j]];
+      distanceSum += std::sqrt(distance[j]);
+      // Neighbours without a return at a horizon do not count for it
+      for (int c = 0; c < RETURN_COLUMNS; ++c) {
+        double value = returns[c][row];
+        if (!NumericVector::is_na(value) && value != MISSING_RETURN) {
+          returnSum[c] += value;
+          ++returnCount[c];
+        }
+      }
+      // R indices start at 1
+      neighbourPattern.push_back(i + 1);
+      neighbourRow.push_back(row + 1);
+      neighbourRank.push_back(j + 1);
+      neighbourDistance.push_back(std::sqrt(distance[j]));
+    }
+    neighbourCount[i] = found;
+    meanDistance[i] = distanceSum / found;
+    for (int c = 0; c < RETURN_COLUMNS; ++c) {
+      meanReturns[c][i] = returnCount[c] > 0 ? returnSum[c] / returnCount[c] : NA_REAL;
+    }
+  }
+
+  Rcpp::List forecast = Rcpp::List::create(
+    Rcpp::Named("PatternName")  = PatternName,
+    Rcpp::Named("neighbours")   = neighbourCount,
+    Rcpp::Named("meanDistance") = meanDistance
+  );
+  for (int c = 0; c < RETURN_COLUMNS; ++c) {
+    forecast.push_back(meanReturns[c], RETURN_NAMES[c]);
+  }
+
+  Rcpp::DataFrame neighbours = Rcpp::DataFrame::create(
+    Rcpp::Named("pattern")   = neighbourPattern,
+    Rcpp::Named("neighbour") = neighbourRow,
+    Rcpp::Named("rank")      = neighbourRank,
+    Rcpp::Named("distance")  = neighbourDistance
+  );
+
+  return Rcpp::List::create(
+    Rcpp::Named("forecast")   = Rcpp::DataFrame(forecast),
+    Rcpp::Named("neighbours") = neighbours
+  );
+}
@@ -0,0 +1,240 @@
+#include <vector>
+#include <string>
+#include <map>
+#include <cmath>
+#include <limits>
+#include <algorithm>
+#include "cppHeader.hpp"
+
+/**
+ * @file clusterPatterns.cpp
+ * @brief k-means clustering of pattern shapes
+ *
+ * The shapes are those of analogForecast (relative times and prices of the pattern
+ * points), clustered separately per pattern name and number of points. Seeding is
+ * k-means++. Afterwards either Lloyd iterations over all shapes or mini-batch updates
+ * (Sculley) over random samples, for millions of patterns. Assigning shapes to their
+ * nearest centroid is the expensive step and runs on OpenMP threads; random numbers
+ * come from R, outside the parallel regions, so set.seed reproduces the clustering.
+ */
+
+// Nearest centroid of the points rows[j] into cluster[j], points and centroids stored point
+// after point
+static void assignPoints(const std::vector<double>& points, const std::vector<int>& rows, int dim,
+                         const std::vector<double>& centroids, std::vector<int>& cluster) {
+  int n = rows.size();
+  int k = centroids.size() / dim;
+
+#pragma omp parallel for schedule(static)
+  for (int j = 0; j < n; ++j) {
+    const double* p = points.data() + rows[j] * dim;
+    double best = std::numeric_limits<double>::infinity();
+    int bestCluster = 0;
+    for (int c = 0; c < k; ++c) {
+      const double* centroid = centroids.data() + c * dim;
+      double distance = 0;
+      for (int d = 0; d < dim; ++d) {
+        distance += (p[d] - centroid[d]) * (p[d] - centroid[d]);
+      }
+      if (distance < best) {
+        best = distance;
+        bestCluster = c;
+      }
+    }
+    cluster[j] = bestCluster;
+  }
+}
+
+// k-means++: the first centroid uniformly, every further one with probability
+// proportional to the squared distance to the nearest centroid so far
+static std::vector<double> seedCentroids(const std::vector<double>& points, int n, int dim, int k) {
+  std::vector<double> centroids;
+  std::vector<double> nearest(n, std::numeric_limits<double>::infinity());
+  int next = std::min((int)(R::unif_rand() * n), n - 1);
+  for (int c = 0; c < k; ++c) {
+    centroids.insert(centroids.end(), points.begin() + next * dim, points.begin() + (next + 1) * dim);
+    if (c == k - 1) {
+      break;
+    }
+    const double* centroid = points.data() + next * dim;
+
+    double total = 0;
+#pragma omp parallel for schedule(static) reduction(+:total)
+    for (int j = 0; j < n; ++j) {
+      double distance = 0;
+      for (int d = 0; d < dim; ++d) {
+        distance += (points[j * dim + d] - centroid[d]) * (points[j * dim + d] - centroid[d]);
+      }
+      nearest[j] = std::min(nearest[j], distance);
+      total += nearest[j];
+    }
+
+    // One draw per centroid. Only duplicates of the centroids left: any point will do
+    double u = R::unif_rand();
+    if (!(total > 0)) {
+      next = std::min((int)(u * n), n - 1);
+      continue;
+    }
+    // Rounding may leave the target at the end, then the last point with a distance
+    double target = u * total;
+    for (int j = 0; j < n; ++j) {
+      if (nearest[j] > 0) {
+        next = j;
+      }
+      target -= nearest[j];
+      if (target < 0) {
+        break;
+      }
+    }
+  }
+  return centroids;
+}
+
+//' @name clusterPatterns
+//' @title clusterPatterns
+//' @description Clusters the patterns of a fastFind result by shape (times relative to the duration and prices relative to the range of the pattern points, as in analogForecast), separately for every pattern name. k-means++ seeding, then Lloyd iterations until no pattern changes its cluster, or with batchSize > 0 mini-batch k-means on random samples of batchSize patterns per iteration. Multithreaded with OpenMP, reproducible with set.seed.
+//' @param patterns fastFind result, e.g. of many series bound together
+//' @param k Number of clusters per pattern name
+//' @param batchSize Patterns per mini-batch, 0 for Lloyd iterations over all patterns
+//' @param maxIterations Maximum number of iterations or mini-batches
+//' @return Returns a list with cluster, the cluster id of every pattern (NA for patterns without a shape), and centroids, one row per cluster with cluster, PatternName, size, the summed squared distance of its patterns (withinss) and the coordinates t1..t4 (relative times of the inner points) and p0..p5 (relative prices), NA for points the pattern does not have
+//' @export
+// [[Rcpp::export]]
+Rcpp::List clusterPatterns(Rcpp::List patterns,
+                           int k = 5,
+                           int batchSize = 0,
+                           int maxIterations = 100
+){
+
+  if (k < 1 || maxIterations < 1) {
+    stop("k and maxIterations have to be positive.");
+  }
+
+  std::vector<std::string> group;
+  std::vector<std::vector<double>> shape;
+  patternShapes(patterns, group, shape);
+  int n = group.size();
+
+  std::map<std::string, std::vector<int>> groupRows;
+  for (int i = 0; i < n; ++i) {
+    if (!group[i].empty()) {
+      groupRows[group[i]].push_back(i);
+    }
+  }
+
+  IntegerVector cluster(n, NA_INTEGER);
+  std::vector<std::string> centroidName;
+  std::vector<int> centroidId, centroidSize;
+  std::vector<double> withinss;
+  std::vector<std::vector<double>> coordinates(10);
+  int nextId = 1;
+
+  for (const auto& entry : groupRows) {
+    const std::vector<int>& rows = entry.second;
+    int size = rows.size();
+    int dim = shape[rows[0]].size();
+    int clusters = std::min(k, size);
+
+    std::vector<double> points;
+    points.reserve(size * dim);
+    for (int row : rows) {
+      points.insert(points.end(), shape[row].begin(), shape[row].end());
+    }
+    std::vector<int> all(size);
+    for (int j = 0; j < size; ++j) {
+      all[j] = j;
+    }
+
+    std::vector<double> centroids = seedCentroids(points, size, dim, clusters);
+    std::vector<int> assigned(size, -1);
+
+    if (batchSize > 0 && batchSize < size) {
+      // Mini-batch: every centroid moves towards its samples with a decreasing rate
+      std::vector<int> seen(clusters, 0);
+      std::vector<int> batch(batchSize), batchCluster(batchSize);
+      for (int it = 0; it < maxIterations; ++it) {
+        for (int& j : batch) {
+          j = std::min((int)(R::unif_rand() * size), size - 1);
+        }
+        assignPoints(points, batch, dim, centroids, batchCluster);
+        for (int b = 0; b < batchSize; ++b) {
+          int j = batch[b];
+          int c = batchCluster[b];
+          double rate = 1.0 / ++seen[c];
+          for (int d = 0; d < dim; ++d) {
+            centroids[c * dim + d] += rate * (points[j * dim + d] - centroids[c * dim + d]);
+          }
+        }
+      }
+      assignPoints(points, all, dim, centroids, assigned);
+    } else {
+      std::vector<int> previous;
+      for (int it = 0; it < maxIterations && assigned != previous; ++it) {
+        previous = assigned;
+        assignPoints(points, all, dim, centroids, assigned);
+
+        // Empty clusters keep their centroid
+        std::vector<double> sum(clusters * dim, 0);
+        std::vector<int> count(clusters, 0);
+        for (int j = 0; j < size; ++j) {
+          ++count[assigned[j]];
+          for (int d = 0; d < dim; ++d) {
+            sum[assigned[j] * dim + d] += points[j * dim + d];
+          }
+        }
+        for (int c = 0; c < clusters; ++c) {
+          for (int d = 0; d < dim && count[c] > 0; ++d) {
+            centroids[c * dim + d] = sum[c * dim + d] / count[c];
+          }
+        }
+      }
+      assignPoints(points, all, dim, centroids, assigned);
+    }
+
+    // Cluster ids are unique over all pattern names
+    std::vector<int> count(clusters, 0);
+    std::vector<double> squares(clusters, 0);
+    for (int j = 0; j < size; ++j) {
+      int c = assigned[j];
+      cluster[rows[j]] = nextId + c;
+      ++count[c];
+      for (int d = 0; d < dim; ++d) {
+        squares[c] += (points[j * dim + d] - centroids[c * dim + d]) * (points[j * dim + d] - centroids[c * dim + d]);
+      }
+    }
+
+    // Shapes hold the relative times of points 1..points-2, then the prices of all points
+    int pointCount = (dim + 2) / 2;
+    std::string name = entry.first.substr(0, entry.first.rfind('/'));
+    for (int c = 0; c < clusters; ++c) {
+      centroidId.push_back(nextId + c);
+      centroidName.push_back(name);
+      centroidSize.push_back(count[c]);
+      withinss.push_back(squares[c]);
+      for (int t = 1; t <= 4; ++t) {
+        coordinates[t-1].push_back(t < pointCount - 1 ? centroids[c * dim + t - 1] : NA_REAL);
+      }
+      for (int p = 0; p < 6; ++p) {
+        coordinates[4+p].push_back(p < pointCount ? centroids[c * dim + pointCount - 2 + p] : NA_REAL);
+      }
+    }
+    nextId += clusters;
+  }
+
+  Rcpp::DataFrame centroids = Rcpp::DataFrame::create(
+    Rcpp::Named("cluster")     = centroidId,
+    Rcpp::Named("PatternName") = centroidName,
+    Rcpp::Named("size")        = centroidSize,
+    Rcpp::Named("withinss")    = withinss,
+    Rcpp::Named("t1") = coordinates[0], Rcpp::Named("t2") = coordinates[1],
+    Rcpp::Named("t3") = coordinates[2], Rcpp::Named("t4") = coordinates[3],
+    Rcpp::Named("p0") = coordinates[4], Rcpp::Named("p1") = coordinates[5],
+    Rcpp::Named("p2") = coordinates[6], Rcpp::Named("p3") = coordinates[7],
+    Rcpp::Named("p4") = coordinates[8], Rcpp::Named("p5") = coordinates[9]
+  );
+
+  return Rcpp::List::create(
+    Rcpp::Named("cluster")   = cluster,
+    Rcpp::Named("centroids") = centroids
+  );
+}
@@ -2,8 +2,12 @@
 #define cppHeader_hpp
 
 #include <Rcpp.h>
+#include <vector>
+#include <string>
 using namespace Rcpp;
 double getSlope(double x1, double x2, double y1, double y2);
 double linearInterpolation(double x1, double x2, double y1, double y2, double atPosition);
+void patternShapes(const Rcpp::List& result, std::vector<std::string>& group,
+                   std::vector<std::vector<double>>& shape);
 
 #endif
@@ -0,0 +1,302 @@
+#include <vector>
+#include <cmath>
+#include <limits>
+#include <numeric>
+#include <algorithm>
+#include "cppHeader.hpp"
+
+/**
+ * @file dtwSearch.cpp
+ * @brief Top-k DTW subsequence search of a reference shape over many series
+ *
+ * UCR suite style: every subsequence is z-normalized on the fly from running sums and
+ * compared with the z-normalized query under a Sakoe-Chiba band. Before the O(m * r)
+ * DTW the cascade LB_Kim (first and last points), LB_Keogh of the candidate against
+ * the query envelope and LB_Keogh of the query against the candidate envelope drops
+ * all subsequences that cannot beat the k-th best match so far. The bounds abandon as
+ * soon as they pass it, and so does the DTW, helped by the remaining terms of the
+ * tighter of the two LB_Keogh bounds. Terms of both envelopes must not be mixed per
+ * point, their pointwise maximum is no lower bound.
+ * Series are spread over OpenMP threads, each with its own top-k list.
+ */
+
+// A match of the query, start and squared DTW distance
+struct DtwMatch {
+  int series;
+  int start;
+  double distance;
+};
+
+// Upper and lower envelope of x within +-r
+static void envelope(const std::vector<double>& x, int r, std::vector<double>& upper,
+                     std::vector<double>& lower) {
+  int n = x.size();
+  upper.resize(n);
+  lower.resize(n);
+  // Monotone deques of indices (Lemire), O(n)
+  std::vector<int> maxQueue(n), minQueue(n);
+  int maxFront = 0, maxBack = 0, minFront = 0, minBack = 0;
+  for (int i = 0; i < n + r; ++i) {
+    if (i < n) {
+      while (maxBack > maxFront && x[maxQueue[maxBack-1]] <= x[i]) --maxBack;
+      maxQueue[maxBack++] = i;
+      while (minBack > minFront && x[minQueue[minBack-1]] >= x[i]) --minBack;
+      minQueue[minBack++] = i;
+    }
+    int center = i - r;
+    if (center >= 0) {
+      while (maxQueue[maxFront] < center - r) ++maxFront;
+      while (minQueue[minFront] < center - r) ++minFront;
+      upper[center] = x[maxQueue[maxFront]];
+      lower[center] = x[minQueue[minFront]];
+    }
+  }
+}
+
+static inline double squared(double d) {
+  return d * d;
+}
+
+// Squared distances of the first and last points, the ones every warping path contains
+static double lbKim(const double* c, double mean, double sd, const std::vector<double>& q) {
+  int m = q.size();
+  return squared((c[0] - mean) / sd - q[0]) + squared((c[m-1] - mean) / sd - q[m-1]);
+}
+
+// LB_Keogh of the z-normalized candidate against the query envelope, the query points in
+// order of decreasing magnitude so it grows fast. Fills the term of every query point
+static double lbKeoghQuery(const double* c, double mean, double sd, const std::vector<int>& order,
+                           const std::vector<double>& upper, const std::vector<double>& lower,
+                           double bound, std::vector<double>& terms) {
+  double lb = 0;
+  for (size_t k = 0; k < order.size() && lb < bound; ++k) {
+    int i = order[k];
+    double z = (c[i] - mean) / sd;
+    double term = z > upper[i] ? squared(z - upper[i]) : z < lower[i] ? squared(z - lower[i]) : 0;
+    terms[i] = term;
+    lb += term;
+  }
+  return lb;
+}
+
+// LB_Keogh of the query against the z-normalized candidate envelope
+static double lbKeoghCandidate(const std::vector<double>& q, const std::vector<int>& order,
+                               const double* upper, const double* lower, double mean, double sd,
+                               double bound, std::vector<double>& terms) {
+  double lb = 0;
+  for (size_t k = 0; k < order.size() && lb < bound; ++k) {
+    int i = order[k];
+    double u = (upper[i] - mean) / sd;
+    double l = (lower[i] - mean) / sd;
+    double term = q[i] > u ? squared(q[i] - u) : q[i] < l ? squared(q[i] - l) : 0;
+    terms[i] = term;
+    lb += term;
+  }
+  return lb;
+}
+
+// Squared DTW distance within the band r. Abandoned with infinity once the cheapest cell
+// of a row plus the bound of the points not reached yet (remaining[i+r+1]) reaches bound
+static double dtw(const std::vector<double>& q, const std::vector<double>& z,
+                  const std::vector<double>& remaining, int r, double bound,
+                  std::vector<double>& previous, std::vector<double>& current) {
+  const double INF = std::numeric_limits<double>::infinity();
+  int m = q.size();
+  std::fill(previous.begin(), previous.end(), INF);
+  for (int i = 0; i < m; ++i) {
+    std::fill(current.begin(), current.end(), INF);
+    double rowMin = INF;
+    // Cell k of row i is column i - r + k
+    for (int j = std::max(0, i - r); j <= std::min(m - 1, i + r); ++j) {
+      int k = j - i + r;
+      double best = 0;
+      if (i > 0 || j > 0) {
+        double diagonal = previous[k];
+        double up       = k < 2 * r ? previous[k+1] : INF;
+        double left     = k > 0     ? current[k-1]  : INF;
+        best = std::min(diagonal, std::min(up, left));
+      }
+      current[k] = best + squared(q[i] - z[j]);
+      rowMin = std::min(rowMin, current[k]);
+    }
+    double rest = i + r + 1 < m ? remaining[i+r+1] : 0;
+    if (rowMin + rest >= bound) {
+      return INF;
+    }
+    std::swap(previous, current);
+  }
+  return previous[r];
+}
+
+// Adds a match to the best ones unless an overlapping match of the same series is closer,
+// overlapping ones that are farther are replaced. Returns the k-th best distance
+static double keepBest(std::vector<DtwMatch>& best, const DtwMatch& match, int m, int topK) {
+  auto overlaps = [&](const DtwMatch& other) {
+    return other.series == match.series && std::abs(other.start - match.start) < m;
+  };
+  for (const DtwMatch& other : best) {
+    if (overlaps(other) && other.distance <= match.distance) {
+      return (int)best.size() < topK ? std::numeric_limits<double>::infinity() : best.back().distance;
+    }
+  }
+  best.erase(std::remove_if(best.begin(), best.end(), overlaps), best.end());
+  best.insert(std::upper_bound(best.begin(), best.end(), match, [](const DtwMatch& a, const DtwMatch& b) {
+    return a.distance < b.distance;
+  }), match);
+  if ((int)best.size() > topK) {
+    best.pop_back();
+  }
+  return (int)best.size() < topK ? std::numeric_limits<double>::infinity() : best.back().distance;
+}
+
+//' @name dtwSearch
+//' @title dtwSearch
+//' @description Searches many series for the subsequences most similar to a reference shape under dynamic time warping, e.g. SHS with uneven shoulder durations. Query and subsequences are z-normalized, the warping stays within a Sakoe-Chiba band. The cascading lower bounds LB_Kim and LB_Keogh and early abandoning skip most of the DTW computations without changing the result. Multithreaded across series with OpenMP.
+//' @param Original_times List with the times of every series
+//' @param Original_prices List with the prices of every series
+//' @param query Prices of the reference shape
+//' @param topK Number of matches, overlapping matches of one series are reported once
+//' @param warpingWindow Band width as fraction of the query length
+//' @return Returns a data.frame with the topK matches, closest first: series, startIdx and endIdx (in the original series, one based), the DTW distance of the z-normalized sequences and the time stamps of start and end
+//' @export
+// [[Rcpp::export]]
+Rcpp::DataFrame dtwSearch(Rcpp::List Original_times,
+                          Rcpp::List Original_prices,
+                          NumericVector query,
+                          int topK = 5,
+                          double warpingWindow = 0.1
+){
+
+  int m = query.size();
+  int r = std::min(std::max((int)std::floor(warpingWindow * m), 0), m - 1);
+  if (m < 2 || topK < 1 || Original_times.size() != Original_prices.size()) {
+    stop("query needs at least 2 prices, topK has to be positive and every series needs times and prices.");
+  }
+
+  // Plain copies, the threads must not touch R objects
+  int seriesCount = Original_prices.size();
+  std::vector<std::vector<double>> prices(seriesCount);
+  for (int s = 0; s < seriesCount; ++s) {
+    NumericVector p = Original_prices[s];
+    prices[s].assign(p.begin(), p.end());
+  }
+
+  std::vector<double> q(query.begin(), query.end());
+  double queryMean = std::accumulate(q.begin(), q.end(), 0.0) / m;
+  double queryVariance = 0;
+  for (double v : q) {
+    queryVariance += squared(v - queryMean);
+  }
+  if (queryVariance <= 0) {
+    stop("query must not be flat.");
+  }
+  for (double& v : q) {
+    v = (v - queryMean) / std::sqrt(queryVariance / m);
+  }
+
+  // Query points by decreasing magnitude, they tighten the bounds first
+  std::vector<int> order(m);
+  std::iota(order.begin(), order.end(), 0);
+  std::sort(order.begin(), order.end(), [&](int a, int b) { return std::fabs(q[a]) > std::fabs(q[b]); });
+  std::vector<double> queryUpper, queryLower;
+  envelope(q, r, queryUpper, queryLower);
+
+  std::vector<DtwMatch> matches;
+
+#pragma omp parallel
+{
+  std::vector<DtwMatch> best;
+  double bound = std::numeric_limits<double>::infinity();
+  std::vector<double> termsQuery(m), termsCandidate(m), remaining(m + 1), z(m);
+  std::vector<double> previous(2 * r + 1), current(2 * r + 1);
+  std::vector<double> upper, lower;
+
+#pragma omp for schedule(dynamic) nowait
+  for (int s = 0; s < seriesCount; ++s) {
+    const std::vector<double>& x = prices[s];
+    int n = x.size();
+    if (n < m) {
+      continue;
+    }
+    envelope(x, r, upper, lower);
+
+    // Running sums of the subsequence x[i..i+m-1]
+    long double sum = 0, sumSquares = 0;
+    for (int k = 0; k < m; ++k) {
+      sum += x[k];
+      sumSquares += (long double)x[k] * x[k];
+    }
+    for (int i = 0; i + m <= n; ++i) {
+      if (i > 0) {
+        sum += x[i+m-1] - x[i-1];
+        sumSquares += (long double)x[i+m-1] * x[i+m-1] - (long double)x[i-1] * x[i-1];
+      }
+      double mean = sum / m;
+      double variance = (double)(sumSquares / m) - mean * mean;
+      // Flat subsequences normalize to zeros
+      double sd = variance > 0 ? std::sqrt(variance) : 1;
+      const double* c = x.data() + i;
+
+      if (lbKim(c, mean, sd, q) >= bound) {
+        continue;
+      }
+      double lbQuery = lbKeoghQuery(c, mean, sd, order, queryUpper, queryLower, bound, termsQuery);
+      if (lbQuery >= bound) {
+        continue;
+      }
+      double lbCandidate = lbKeoghCandidate(q, order, upper.data() + i, lower.data() + i, mean, sd,
+                                            bound, termsCandidate);
+      if (lbCandidate >= bound) {
+        continue;
+      }
+
+      // Bound of the points from k on, from the terms of the tighter LB_Keogh as a whole
+      const std::vector<double>& terms = lbQuery >= lbCandidate ? termsQuery : termsCandidate;
+      remaining[m] = 0;
+      for (int k = m - 1; k >= 0; --k) {
+        remaining[k] = remaining[k+1] + terms[k];
+      }
+      for (int k = 0; k < m; ++k) {
+        z[k] = (c[k] - mean) / sd;
+      }
+      double distance = dtw(q, z, remaining, r, bound, previous, current);
+      if (distance < bound) {
+        bound = keepBest(best, {s, i, distance}, m, topK);
+      }
+    }
+  }
+
+#pragma omp critical
+  matches.insert(matches.end(), best.begin(), best.end());
+}
+
+  // A series is searched by one thread only, so the threads' matches never overlap
+  std::sort(matches.begin(), matches.end(), [](const DtwMatch& a, const DtwMatch& b) {
+    return a.distance < b.distance || (a.distance == b.distance &&
+           (a.series < b.series || (a.series == b.series && a.start < b.start)));
+  });
+  if ((int)matches.size() > topK) {
+    matches.resize(topK);
+  }
+
+  std::vector<int> series, startIdx, endIdx;
+  std::vector<double> distance, timeStamp0, timeStampEnd;
+  for (const DtwMatch& match : matches) {
+    NumericVector times = Original_times[match.series];
+    // R indices start at 1
+    series.push_back(match.series + 1);
+    startIdx.push_back(match.start + 1);
+    endIdx.push_back(match.start + m);
+    distance.push_back(std::sqrt(match.distance));
+    timeStamp0.push_back(times[match.start]);
+    timeStampEnd.push_back(times[match.start + m - 1]);
+  }
+
+  return Rcpp::DataFrame::create(Rcpp::Named("series")       = series,
+                                 Rcpp::Named("startIdx")     = startIdx,
+                                 Rcpp::Named("endIdx")       = endIdx,
+                                 Rcpp::Named("distance")     = distance,
+                                 Rcpp::Named("timeStamp0")   = timeStamp0,
+                                 Rcpp::Named("timeStampEnd") = timeStampEnd
+  );
+}
@@ -0,0 +1,172 @@
+#include <vector>
+#include <string>
+#include <cmath>
+#include <map>
+#include <algorithm>
+#include "FastFind.hpp"
+
+/**
+ * @file findGaps.cpp
+ * @brief Price gaps and island reversals on bar or tick data
+ *
+ * One pass over the bars finds the gaps. Their fill time is resolved with a
+ * range-extremum index over the lows and highs, so the pass stays O(n log n) however
+ * long a gap stays open. The result has the columnar format of fastFind.
+ */
+
+// A detected gap between the bars k-1 and k
+struct Gap {
+  int k = -1;
+  double edge;        // side of bar k-1 the gap starts at (high for gaps up, low for gaps down)
+  int fillIdx;        // first bar after k trading back to edge, -1 if the gap stays open
+};
+
+// Gap and island patterns use bar indices. The trend stays undefined, it is measured on PIPs
+void setGapPattern(const std::string& name, const std::vector<int>& bars,
+                   const std::vector<double>& barPrices, int breakoutIdx,
+                   const NumericVector& times, const NumericVector& prices,
+                   PatternData& pattern) {
+  int* pointIdx[6] = {&pattern.startIdx, &pattern.leftShoulderIdx, &pattern.necklineStartIdx,
+                      &pattern.headIdx, &pattern.necklineEndIdx, &pattern.rightShoulderIdx};
+
+  pattern.patternName = name;
+  pattern.timeStamps.assign(WINDOW_SIZE, NA_INTEGER);
+  pattern.priceStamps.assign(WINDOW_SIZE, NA_REAL);
+  for (int k = 0; k < 6; ++k) {
+    *pointIdx[k] = bars[k];
+    if (bars[k] >= 0) {
+      pattern.timeStamps[k]  = times[bars[k]];
+      pattern.priceStamps[k] = barPrices[k];
+    }
+  }
+  // Bought at the bar after the gap, as after a breakout in fastFind
+  pattern.breakoutIdx = breakoutIdx;
+  if (breakoutIdx + 1 < prices.size()) {
+    pattern.timeStamps[6]  = times[breakoutIdx + 1];
+    pattern.priceStamps[6] = prices[breakoutIdx + 1];
+  }
+
+  pattern.trendBeginPrice = -1;
+  pattern.trendBeginTime  = INVALID_TIME;
+  pattern.trendEndPrice   = -1;
+  pattern.trendEndTime    = INVALID_TIME;
+}
+
+//' @name findGaps
+//' @title findGaps
+//' @description Finds price gaps and island reversals in one pass over bars or ticks. A gap up opens when a bar's low lies above the previous high (gap down vice versa) by at least minGap times the local volatility, i.e. the standard deviation of the last volatilityWindow price changes before the gap. The gap is filled at the first later bar trading back to the previous high (low), found with a range-extremum index. An island top (bottom) is a gap up (down) followed within maxIslandBars by a gap down (up), with all island bars beyond both gaps.
+//' @param Original_times Vector with time or indices
+//' @param Original_prices Vector with prices, the closes for bars
+//' @param high Highs of the bars, NULL for ticks (the prices are used)
+//' @param low Lows of the bars, NULL for ticks (the prices are used)
+//' @param minGap Minimum gap size in volatility units
+//' @param maxIslandBars Maximum number of bars on an island
+//' @param volatilityWindow Number of price changes the volatility is measured on
+//' @return Returns a list in the format of fastFind. PatternName is GAPUP, GAPDOWN, ITOP or IBOT, the indices are bar indices. Gaps: startIdx is the bar before the gap, leftShoulderIdx the bar after it and necklineStartIdx the bar filling it (NA if open), with price stamps at the gap edges and the fill level. Islands: startIdx and leftShoulderIdx frame the first gap, headIdx is the island extreme, necklineEndIdx and rightShoulderIdx frame the second gap. breakoutIdx is the bar after the (last) gap, returns are measured from the following bar
+//' @export
+// [[Rcpp::export]]
+Rcpp::List findGaps(NumericVector Original_times,
+                    NumericVector Original_prices,
+                    Rcpp::Nullable<NumericVector> high = R_NilValue,
+                    Rcpp::Nullable<NumericVector> low = R_NilValue,
+                    double minGap = 1.0,
+                    int maxIslandBars = 10,
+                    int volatilityWindow = 20
+){
+
+  // Ticks have no range, every price is its own high and low
+  NumericVector highs = high.isNotNull() ? NumericVector(high.get()) : Original_prices;
+  NumericVector lows  = low.isNotNull()  ? NumericVector(low.get())  : Original_prices;
+  int n = Original_prices.size();
+  if (highs.size() != n || lows.size() != n || Original_times.size() != n) {
+    stop("Original_times, Original_prices, high and low need the same length.");
+  }
+
+  RollingVolatility volatility(Original_prices);
+  RangeExtremum highIndex(highs);
+  RangeExtremum lowIndex(lows);
+
+  std::vector<PatternData> patterns;
+  std::map<std::string, PatternCount> counts;
+
+  // Counts the pattern, it is reported if there is a bar to buy at after its breakout
+  auto countPattern = [&](const PatternData& pattern, int breakoutIdx) {
+    PatternCount& count = counts[pattern.patternName];
+    ++count.candidates;
+    if (breakoutIdx + 1 >= n) {
+      return false;
+    }
+    ++count.breakouts;
+    return true;
+  };
+
+  Gap lastUp, lastDown;
+  for (int k = 1; k < n; ++k) {
+    // Volatility known before the gap
+    double sigma = volatility.at(k - 1, volatilityWindow);
+    if (sigma <= 0) {
+      continue;
+    }
+
+    double up   = lows[k] - highs[k-1];
+    double down = lows[k-1] - highs[k];
+    bool isUp   = up   > 0 && up   >= minGap * sigma;
+    bool isDown = down > 0 && down >= minGap * sigma;
+    if (!isUp && !isDown) {
+      continue;
+    }
+
+    Gap gap;
+    gap.k = k;
+    if (isUp) {
+      gap.edge    = highs[k-1];
+      gap.fillIdx = k + 1 < n ? lowIndex.firstBelow(k + 1, std::nextafter(gap.edge, INFINITY)) : -1;
+    } else {
+      gap.edge    = lows[k-1];
+      gap.fillIdx = k + 1 < n ? highIndex.firstAbove(k + 1, std::nextafter(gap.edge, -INFINITY)) : -1;
+    }
+
+    PatternData pattern;
+    setGapPattern(isUp ? "GAPUP" : "GAPDOWN",
+                  {k - 1, k, gap.fillIdx, -1, -1, -1},
+                  {gap.edge, isUp ? lows[k] : highs[k], gap.edge, NA_REAL, NA_REAL, NA_REAL},
+                  k, Original_times, Original_prices, pattern);
+    if (countPattern(pattern, k)) {
+      calculateReturns(Original_prices, Original_times, k + 1, k - 1,
+                       pattern.returns, pattern.relReturns);
+      patterns.push_back(pattern);
+    }
+
+    // Island: the opposite gap of this one opened shortly before and the
+    // island bars in between stay beyond both gap edges
+    const Gap& first = isUp ? lastDown : lastUp;
+    if (first.k >= 0 && k - first.k <= maxIslandBars) {
+      bool island = isUp ? highIndex.max(first.k, k - 1) < std::min(first.edge, lows[k])
+                         : lowIndex.min(first.k, k - 1)  > std::max(first.edge, highs[k]);
+      if (island) {
+        // Island extreme, the island has at most maxIslandBars bars
+        int head = first.k;
+        for (int j = first.k + 1; j < k; ++j) {
+          bool beyond = isUp ? lows[j] < lows[head] : highs[j] > highs[head];
+          head = beyond ? j : head;
+        }
+        PatternData islandPattern;
+        setGapPattern(isUp ? "IBOT" : "ITOP",
+                      {first.k - 1, first.k, -1, head, k - 1, k},
+                      {first.edge, isUp ? highs[first.k] : lows[first.k], NA_REAL,
+                       isUp ? lows[head] : highs[head],
+                       isUp ? highs[k-1] : lows[k-1], isUp ? lows[k] : highs[k]},
+                      k, Original_times, Original_prices, islandPattern);
+        if (countPattern(islandPattern, k)) {
+          calculateReturns(Original_prices, Original_times, k + 1, first.k - 1,
+                           islandPattern.returns, islandPattern.relReturns);
+          patterns.push_back(islandPattern);
+        }
+      }
+    }
+
+    (isUp ? lastUp : lastDown) = gap;
+  }
+
+  return patternResults(patterns, counts);
+}
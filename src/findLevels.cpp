@@ -0,0 +1,137 @@
+#include <vector>
+#include <set>
+#include <cmath>
+#include <numeric>
+#include <algorithm>
+#include "cppHeader.hpp"
+
+//' @name findLevels
+//' @title findLevels
+//' @description Clusters the PIP prices into horizontal support/resistance levels. The prices are sorted once and swept: a level collects prices until one lies more than levelTolerance above its lowest price, so the clustering is O(n log n) and deterministic.
+//' @param PrePro_indexFilter PIP positions in the original series (zero based)
+//' @param Original_times Vector with time or indices
+//' @param Original_prices Vector with prices
+//' @param levelTolerance Maximum width of a level relative to its lowest price
+//' @param minTouches Minimum number of PIPs touching a level
+//' @return Returns a data.frame with one row per level: its mean price, the price band, the number of touches, the time of the first touch, the time the level is confirmed (touch number minTouches) and the time of the last touch
+//' @export
+// [[Rcpp::export]]
+Rcpp::DataFrame findLevels(IntegerVector PrePro_indexFilter,
+                           NumericVector Original_times,
+                           NumericVector Original_prices,
+                           double levelTolerance = 0.01,
+                           int minTouches = 2
+){
+
+  // Sucht PIPs im Originaldatensatz
+  NumericVector QuerySeries_times  = Original_times[PrePro_indexFilter];
+  NumericVector QuerySeries_prices = Original_prices[PrePro_indexFilter];
+  int n = QuerySeries_prices.size();
+
+  // PIPs in price order
+  std::vector<int> order(n);
+  std::iota(order.begin(), order.end(), 0);
+  std::sort(order.begin(), order.end(), [&](int a, int b) {
+    return QuerySeries_prices[a] < QuerySeries_prices[b];
+  });
+
+  std::vector<double> level, lowerBound, upperBound, firstTouch, confirmedTime, lastTouch;
+  std::vector<int> touches;
+
+  // One sweep over the sorted prices, each run within the tolerance is a level
+  int first = 0;
+  while (first < n) {
+    double lowest = QuerySeries_prices[order[first]];
+    int last = first;
+    while (last + 1 < n && QuerySeries_prices[order[last + 1]] <= lowest * (1 + levelTolerance)) {
+      ++last;
+    }
+
+    int count = last - first + 1;
+    if (count >= minTouches) {
+      std::vector<double> touchTimes;
+      touchTimes.reserve(count);
+      double sum = 0;
+      for (int k = first; k <= last; ++k) {
+        sum += QuerySeries_prices[order[k]];
+        touchTimes.push_back(QuerySeries_times[order[k]]);
+      }
+      std::sort(touchTimes.begin(), touchTimes.end());
+
+      level.push_back(sum / count);
+      lowerBound.push_back(lowest);
+      upperBound.push_back(QuerySeries_prices[order[last]]);
+      touches.push_back(count);
+      firstTouch.push_back(touchTimes.front());
+      confirmedTime.push_back(touchTimes[std::max(minTouches, 1) - 1]);
+      lastTouch.push_back(touchTimes.back());
+    }
+    first = last + 1;
+  }
+
+  return Rcpp::DataFrame::create(Rcpp::Named("level")         = level,
+                                 Rcpp::Named("lowerBound")    = lowerBound,
+                                 Rcpp::Named("upperBound")    = upperBound,
+                                 Rcpp::Named("touches")       = touches,
+                                 Rcpp::Named("firstTouch")    = firstTouch,
+                                 Rcpp::Named("confirmedTime") = confirmedTime,
+                                 Rcpp::Named("lastTouch")     = lastTouch
+  );
+}
+
+//' @name nearestLevels
+//' @title nearestLevels
+//' @description Finds for every query the nearest support level below and the nearest resistance level above its price, using only levels that are confirmed at the query time. A level at the query price counts as below. Queries are answered in time order while the confirmed levels are kept in an ordered set, O((levels + queries) log levels).
+//' @param level Level prices, e.g. the column level of findLevels
+//' @param confirmedTime Time from which on a level is known, e.g. the column confirmedTime of findLevels
+//' @param prices Query prices
+//' @param times Query times
+//' @return Returns a data.frame with levelBelow and levelAbove per query, NA if there is no such level
+//' @export
+// [[Rcpp::export]]
+Rcpp::DataFrame nearestLevels(NumericVector level,
+                              NumericVector confirmedTime,
+                              NumericVector prices,
+                              NumericVector times
+){
+
+  int levelCount = level.size();
+  int queryCount = prices.size();
+
+  std::vector<int> levelOrder(levelCount);
+  std::iota(levelOrder.begin(), levelOrder.end(), 0);
+  std::sort(levelOrder.begin(), levelOrder.end(), [&](int a, int b) {
+    return confirmedTime[a] < confirmedTime[b];
+  });
+
+  std::vector<int> queryOrder(queryCount);
+  std::iota(queryOrder.begin(), queryOrder.end(), 0);
+  std::sort(queryOrder.begin(), queryOrder.end(), [&](int a, int b) {
+    return times[a] < times[b];
+  });
+
+  NumericVector levelBelow(queryCount, NA_REAL);
+  NumericVector levelAbove(queryCount, NA_REAL);
+
+  std::multiset<double> known;
+  int next = 0;
+  for (int q : queryOrder) {
+    // Levels confirmed up to the query time
+    while (next < levelCount && confirmedTime[levelOrder[next]] <= times[q]) {
+      known.insert(level[levelOrder[next]]);
+      ++next;
+    }
+
+    auto above = known.upper_bound(prices[q]);
+    if (above != known.end()) {
+      levelAbove[q] = *above;
+    }
+    if (above != known.begin()) {
+      levelBelow[q] = *std::prev(above);
+    }
+  }
+
+  return Rcpp::DataFrame::create(Rcpp::Named("levelBelow") = levelBelow,
+                                 Rcpp::Named("levelAbove") = levelAbove
+  );
+}
@@ -0,0 +1,216 @@
+#include <vector>
+#include <string>
+#include <array>
+#include <cmath>
+#include <algorithm>
+#include <numeric>
+#include "cppHeader.hpp"
+#include "RangeExtremum.hpp"
+
+// Points: start, left shoulder, neckline start, head, neckline end, right shoulder
+struct ShapeFit {
+  std::array<int, 6> points;
+  double score;
+  double prominence;      // head above the higher shoulder, in head heights over the neckline
+  double shoulderDiff;    // price difference of the shoulders, in head heights
+  double timeAsymmetry;   // difference of the shoulder-head durations, relative to the shoulder distance
+  double flatness;        // price difference of the neckline points, in head heights
+};
+
+// Best SHS fit between the PIPs first..last (inclusive) that does not overlap the taken fits.
+// q are the (mirrored for iSHS) PIP prices. Returns false if no fit scores above minScore.
+//
+// Branch and bound: the head is fixed first, then the neckline points and the shoulders.
+// All penalties are >= 0, so a bound of the prominence bounds the score from above and a
+// partial assignment is dropped once it cannot beat the best fit so far. No PIP between a
+// shoulder and its neckline point lies below the neckline point, so neither shoulder is
+// lower than the higher neckline point and the prominence is at most the head above it
+bool bestShapeFit(const NumericVector& t, const std::vector<double>& q, const RangeExtremum& index,
+                  int first, int last, const std::vector<ShapeFit>& taken, double minScore,
+                  ShapeFit& best) {
+  int n = q.size();
+  std::vector<int> highs, lows;
+  for (int j = first; j <= last; ++j) {
+    bool aboveLeft  = j == 0     || q[j] > q[j-1];
+    bool aboveRight = j == n - 1 || q[j] > q[j+1];
+    bool belowLeft  = j == 0     || q[j] < q[j-1];
+    bool belowRight = j == n - 1 || q[j] < q[j+1];
+    if (aboveLeft && aboveRight) {
+      highs.push_back(j);
+    } else if (belowLeft && belowRight) {
+      lows.push_back(j);
+    }
+  }
+
+  // Highest heads first, they give a good bound early
+  std::vector<int> heads = highs;
+  std::sort(heads.begin(), heads.end(), [&](int a, int b) { return q[a] > q[b]; });
+
+  auto overlaps = [&](int from, int to) {
+    for (const ShapeFit& fit : taken) {
+      if (from <= fit.points[5] && fit.points[0] <= to) {
+        return true;
+      }
+    }
+    return false;
+  };
+
+  double bestScore = minScore;
+  bool found = false;
+  for (int h : heads) {
+    for (int n2 : lows) {
+      // The neckline points are the troughs between the shoulders and the head
+      if (n2 >= h || index.min(n2, h) < q[n2]) {
+        continue;
+      }
+      for (int n4 : lows) {
+        if (n4 <= h || index.min(h, n4) < q[n4]) {
+          continue;
+        }
+        auto neckline = [&](int j) {
+          return linearInterpolation(t[n2], t[n4], q[n2], q[n4], t[j]);
+        };
+        double height = q[h] - neckline(h);
+        if (height <= 0) {
+          continue;
+        }
+        double flatness = std::fabs(q[n4] - q[n2]) / height;
+        if ((q[h] - std::max(q[n2], q[n4])) / height - flatness <= bestScore) {
+          continue;
+        }
+
+        for (int s1 : highs) {
+          if (s1 >= n2 || q[s1] >= q[h] || q[s1] <= neckline(s1) ||
+              index.min(s1, n2) < q[n2] || index.max(s1, h) > q[h]) {
+            continue;
+          }
+          // The prominence can only shrink with the right shoulder
+          if ((q[h] - q[s1]) / height - flatness <= bestScore) {
+            continue;
+          }
+          // Start: the nearest low before the left shoulder below the neckline,
+          // without a PIP above the left shoulder in between
+          int s0 = -1;
+          for (int j = s1 - 1; j >= first && q[j] <= q[s1]; --j) {
+            if (q[j] < q[n2] && q[j] < neckline(j)) {
+              s0 = j;
+              break;
+            }
+          }
+          if (s0 < 0) {
+            continue;
+          }
+
+          for (int s5 : highs) {
+            if (s5 <= n4 || q[s5] >= q[h] || q[s5] <= neckline(s5) ||
+                index.min(n4, s5) < q[n4] || index.max(h, s5) > q[h] || overlaps(s0, s5)) {
+              continue;
+            }
+            ShapeFit fit;
+            fit.points        = {s0, s1, n2, h, n4, s5};
+            fit.prominence    = (q[h] - std::max(q[s1], q[s5])) / height;
+            fit.shoulderDiff  = std::fabs(q[s1] - q[s5]) / height;
+            fit.timeAsymmetry = std::fabs((t[h] - t[s1]) - (t[s5] - t[h])) / (t[s5] - t[s1]);
+            fit.flatness      = flatness;
+            fit.score = fit.prominence - fit.shoulderDiff - fit.timeAsymmetry - fit.flatness;
+            if (fit.score > bestScore) {
+              bestScore = fit.score;
+              best  = fit;
+              found = true;
+            }
+          }
+        }
+      }
+    }
+  }
+  return found;
+}
+
+//' @name fitSHS
+//' @title fitSHS
+//' @description Scores how well the PIPs fit an idealized SHS/iSHS instead of testing the rules of fastFind as yes/no. The PIPs are split into regions of regionSize PIPs that overlap by half. In every region a branch-and-bound search picks the swing points with the best score = prominence - shoulderDiff - timeAsymmetry - flatness, then the best fit not overlapping it, up to maxInstances per region and pattern. The head is the highest PIP from shoulder to shoulder and the neckline points are the troughs between shoulders and head. A fit found in two regions is reported once.
+//' @param PrePro_indexFilter PIP positions in the original series (zero based)
+//' @param Original_times Vector with time or indices
+//' @param Original_prices Vector with prices
+//' @param regionSize Number of PIPs per region
+//' @param maxInstances Maximum number of fits per region and pattern
+//' @param minScore Only fits scoring above minScore are reported
+//' @return Returns a data.frame with one row per fit: PatternName (SHS or iSHS), the region, the pattern points as PIP indices like fastFind, the score and its components prominence (head above the higher shoulder), shoulderDiff, timeAsymmetry and flatness (neckline slope), all relative to the head height over the neckline. The prominence is at most the head above the higher neckline point, as no shoulder lies below its neckline point
+//' @export
+// [[Rcpp::export]]
+Rcpp::DataFrame fitSHS(IntegerVector PrePro_indexFilter,
+                       NumericVector Original_times,
+                       NumericVector Original_prices,
+                       int regionSize = 30,
+                       int maxInstances = 2,
+                       double minScore = 0.0
+){
+
+  // Sucht PIPs im Originaldatensatz
+  NumericVector QuerySeries_times  = Original_times[PrePro_indexFilter];
+  NumericVector QuerySeries_prices = Original_prices[PrePro_indexFilter];
+  int n = QuerySeries_prices.size();
+  int stride = std::max(regionSize / 2, 1);
+
+  std::vector<std::string> PatternName;
+  std::vector<int> region;
+  std::vector<int> startIdx, leftShoulderIdx, necklineStartIdx, headIdx, necklineEndIdx, rightShoulderIdx;
+  std::vector<double> score, prominence, shoulderDiff, timeAsymmetry, flatness;
+
+  for (int sign : {1, -1}) {
+    // iSHS are SHS of the mirrored prices
+    std::vector<double> q(n);
+    for (int j = 0; j < n; ++j) {
+      q[j] = sign * QuerySeries_prices[j];
+    }
+    RangeExtremum index(q);
+    std::vector<std::array<int, 6>> reported;
+
+    for (int first = 0, r = 1; first < n; first += stride, ++r) {
+      int last = std::min(first + regionSize - 1, n - 1);
+      std::vector<ShapeFit> taken;
+      ShapeFit fit;
+      while ((int)taken.size() < maxInstances &&
+             bestShapeFit(QuerySeries_times, q, index, first, last, taken, minScore, fit)) {
+        taken.push_back(fit);
+        // Overlapping regions find the same fits
+        if (std::find(reported.begin(), reported.end(), fit.points) != reported.end()) {
+          continue;
+        }
+        reported.push_back(fit.points);
+
+        PatternName.push_back(sign > 0 ? "SHS" : "iSHS");
+        region.push_back(r);
+        startIdx.push_back(fit.points[0] + 1);
+        leftShoulderIdx.push_back(fit.points[1] + 1);
+        necklineStartIdx.push_back(fit.points[2] + 1);
+        headIdx.push_back(fit.points[3] + 1);
+        necklineEndIdx.push_back(fit.points[4] + 1);
+        rightShoulderIdx.push_back(fit.points[5] + 1);
+        score.push_back(fit.score);
+        prominence.push_back(fit.prominence);
+        shoulderDiff.push_back(fit.shoulderDiff);
+        timeAsymmetry.push_back(fit.timeAsymmetry);
+        flatness.push_back(fit.flatness);
+      }
+      if (last == n - 1) {
+        break;
+      }
+    }
+  }
+
+  return Rcpp::DataFrame::create(Rcpp::Named("PatternName")      = PatternName,
+                                 Rcpp::Named("region")           = region,
+                                 Rcpp::Named("startIdx")         = startIdx,
+                                 Rcpp::Named("leftShoulderIdx")  = leftShoulderIdx,
+                                 Rcpp::Named("necklineStartIdx") = necklineStartIdx,
+                                 Rcpp::Named("headIdx")          = headIdx,
+                                 Rcpp::Named("necklineEndIdx")   = necklineEndIdx,
+                                 Rcpp::Named("rightShoulderIdx") = rightShoulderIdx,
+                                 Rcpp::Named("score")            = score,
+                                 Rcpp::Named("prominence")       = prominence,
+                                 Rcpp::Named("shoulderDiff")     = shoulderDiff,
+                                 Rcpp::Named("timeAsymmetry")    = timeAsymmetry,
+                                 Rcpp::Named("flatness")         = flatness
+  );
+}
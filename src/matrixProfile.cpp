@@ -0,0 +1,223 @@
+#include <vector>
+#include <string>
+#include <cmath>
+#include <limits>
+#include <numeric>
+#include <algorithm>
+#include "cppHeader.hpp"
+
+/**
+ * @file matrixProfile.cpp
+ * @brief Matrix profile (z-normalized nearest neighbour distance of every subsequence)
+ *
+ * SCRIMP/STOMP style: the dot products of all subsequence pairs on one diagonal of the
+ * distance matrix follow from each other in O(1), so the whole profile is O(n^2)
+ * instead of O(n^2 * m). Diagonals are spread over OpenMP threads, each with its own
+ * profile that is merged at the end. Along a diagonal the correlations and the row and
+ * column updates are SIMD loops.
+ */
+
+// Diagonals per OpenMP work item
+const int DIAGONAL_CHUNK = 64;
+
+// Picks up to count subsequences in the given order, at least windowLength apart from
+// the ones picked before (and from their neighbours if withNeighbour is set)
+std::vector<int> pickNonOverlapping(const std::vector<int>& order, const std::vector<int>& neighbour,
+                                    int windowLength, int count, bool withNeighbour) {
+  std::vector<int> picked, blocked;
+  for (int i : order) {
+    if ((int)picked.size() >= count) {
+      break;
+    }
+    bool overlaps = false;
+    for (int b : blocked) {
+      overlaps = overlaps || std::abs(i - b) < windowLength ||
+                 (withNeighbour && std::abs(neighbour[i] - b) < windowLength);
+    }
+    if (overlaps) {
+      continue;
+    }
+    picked.push_back(i);
+    blocked.push_back(i);
+    if (withNeighbour) {
+      blocked.push_back(neighbour[i]);
+    }
+  }
+  return picked;
+}
+
+//' @name matrixProfile
+//' @title matrixProfile
+//' @description Computes the matrix profile of the price series: for every subsequence of windowLength observations the z-normalized Euclidean distance to its nearest neighbour outside the trivial-match zone (a quarter window). Diagonal traversal makes it O(n^2), multithreaded with OpenMP. The topK motifs are the closest neighbour pairs, the topK discords the subsequences farthest from any other, both without overlaps.
+//' @param Original_times Vector with time or indices
+//' @param Original_prices Vector with prices
+//' @param windowLength Length of the subsequences
+//' @param topK Number of motifs and of discords
+//' @return Returns a list with patternInfo, one row per motif or discord: PatternName (MOTIF or DISCORD), startIdx and endIdx of the subsequence, matchIdx (start of its nearest neighbour), the distance and the time stamps of start, end and match; and matrixProfile with distance and matchIdx of every subsequence (NA if all other subsequences lie in its trivial-match zone). Indices are one based
+//' @export
+// [[Rcpp::export]]
+Rcpp::List matrixProfile(NumericVector Original_times,
+                         NumericVector Original_prices,
+                         int windowLength = 20,
+                         int topK = 3
+){
+
+  int n = Original_prices.size();
+  int m = windowLength;
+  int count = n - m + 1;
+  int exclusion = std::max(1, (m + 3) / 4);
+  if (m < 2 || count <= exclusion) {
+    stop("windowLength has to be at least 2 and leave more than a quarter window of subsequences.");
+  }
+
+  // Centered prices keep the running dot products well conditioned
+  std::vector<double> x(Original_prices.begin(), Original_prices.end());
+  double center = std::accumulate(x.begin(), x.end(), 0.0) / n;
+  for (double& v : x) {
+    v -= center;
+  }
+
+  // Mean and 1 / (sqrt(m) * sd) of every subsequence, 0 for flat ones
+  std::vector<double> mu(count), invScale(count);
+  long double sum = 0, sumSquares = 0;
+  for (int k = 0; k < m; ++k) {
+    sum += x[k];
+    sumSquares += (long double)x[k] * x[k];
+  }
+  for (int i = 0; i < count; ++i) {
+    if (i > 0) {
+      sum += x[i+m-1] - x[i-1];
+      sumSquares += (long double)x[i+m-1] * x[i+m-1] - (long double)x[i-1] * x[i-1];
+    }
+    double mean = sum / m;
+    double variance = std::max((double)(sumSquares / m) - mean * mean, 0.0);
+    mu[i] = mean;
+    invScale[i] = variance > 0 ? 1 / std::sqrt(m * variance) : 0;
+  }
+
+  // Pearson correlation to the nearest neighbour, maximized instead of minimizing the distance
+  std::vector<double> correlation(count, -std::numeric_limits<double>::infinity());
+  std::vector<int> neighbour(count, -1);
+  const double* xs = x.data();
+  const double* mus = mu.data();
+  const double* scales = invScale.data();
+
+#pragma omp parallel
+{
+  std::vector<double> best(count, -std::numeric_limits<double>::infinity());
+  std::vector<int> bestIdx(count, -1);
+  std::vector<double> dot(count), corr(count);
+  double* b = best.data();
+  int* bi = bestIdx.data();
+  double* qt = dot.data();
+  double* c = corr.data();
+
+#pragma omp for schedule(dynamic, DIAGONAL_CHUNK) nowait
+  for (int k = exclusion; k < count; ++k) {
+    int length = count - k;
+
+    // Dot products of the pairs (i, i+k), each from the previous one
+    double q = 0;
+    for (int l = 0; l < m; ++l) {
+      q += xs[l] * xs[k+l];
+    }
+    qt[0] = q;
+    for (int i = 1; i < length; ++i) {
+      q += xs[i+m-1] * xs[i+k+m-1] - xs[i-1] * xs[i+k-1];
+      qt[i] = q;
+    }
+
+    // Rows and columns are updated in separate loops, so no lane writes what another reads
+#pragma omp simd
+    for (int i = 0; i < length; ++i) {
+      c[i] = (qt[i] - m * mus[i] * mus[i+k]) * scales[i] * scales[i+k];
+      bool closer = c[i] > b[i];
+      b[i]  = closer ? c[i] : b[i];
+      bi[i] = closer ? i + k : bi[i];
+    }
+#pragma omp simd
+    for (int i = 0; i < length; ++i) {
+      bool closer = c[i] > b[i+k];
+      b[i+k]  = closer ? c[i] : b[i+k];
+      bi[i+k] = closer ? i : bi[i+k];
+    }
+  }
+
+#pragma omp critical
+  for (int i = 0; i < count; ++i) {
+    // Ties go to the smaller index, whatever thread found them
+    if (bi[i] >= 0 && (b[i] > correlation[i] ||
+                       (b[i] == correlation[i] && bi[i] < neighbour[i]))) {
+      correlation[i] = b[i];
+      neighbour[i]   = bi[i];
+    }
+  }
+}
+
+  NumericVector profile(count);
+  IntegerVector profileIdx(count);
+  std::vector<double> distance(count);
+  // Short series leave subsequences without a neighbour outside their exclusion zone,
+  // they get NA and are neither motif nor discord
+  std::vector<int> order;
+  for (int i = 0; i < count; ++i) {
+    if (neighbour[i] < 0) {
+      distance[i]   = NA_REAL;
+      profile[i]    = NA_REAL;
+      profileIdx[i] = NA_INTEGER;
+      continue;
+    }
+    distance[i]   = std::sqrt(std::max(2.0 * m * (1 - correlation[i]), 0.0));
+    profile[i]    = distance[i];
+    profileIdx[i] = neighbour[i] + 1;
+    order.push_back(i);
+  }
+
+  // Motifs: closest pairs first. Discords: the farthest subsequences first
+  std::stable_sort(order.begin(), order.end(), [&](int a, int b) { return distance[a] < distance[b]; });
+  std::vector<int> motifs = pickNonOverlapping(order, neighbour, m, topK, true);
+  std::reverse(order.begin(), order.end());
+  std::vector<int> discords = pickNonOverlapping(order, neighbour, m, topK, false);
+
+  std::vector<std::string> PatternName;
+  std::vector<int> startIdx, endIdx, matchIdx;
+  std::vector<double> patternDistance, timeStamp0, timeStampEnd, timeStampMatch;
+  auto report = [&](const std::string& name, int i) {
+    PatternName.push_back(name);
+    // R indices start at 1
+    startIdx.push_back(i + 1);
+    endIdx.push_back(i + m);
+    matchIdx.push_back(neighbour[i] + 1);
+    patternDistance.push_back(distance[i]);
+    timeStamp0.push_back(Original_times[i]);
+    timeStampEnd.push_back(Original_times[i + m - 1]);
+    timeStampMatch.push_back(Original_times[neighbour[i]]);
+  };
+  for (int i : motifs) {
+    report("MOTIF", i);
+  }
+  for (int i : discords) {
+    report("DISCORD", i);
+  }
+
+  Rcpp::DataFrame patternInfo = Rcpp::DataFrame::create(
+    Rcpp::Named("PatternName")    = PatternName,
+    Rcpp::Named("startIdx")       = startIdx,
+    Rcpp::Named("endIdx")         = endIdx,
+    Rcpp::Named("matchIdx")       = matchIdx,
+    Rcpp::Named("distance")       = patternDistance,
+    Rcpp::Named("timeStamp0")     = timeStamp0,
+    Rcpp::Named("timeStampEnd")   = timeStampEnd,
+    Rcpp::Named("timeStampMatch") = timeStampMatch
+  );
+
+  Rcpp::DataFrame profileFrame = Rcpp::DataFrame::create(
+    Rcpp::Named("distance") = profile,
+    Rcpp::Named("matchIdx") = profileIdx
+  );
+
+  return Rcpp::List::create(
+    Rcpp::Named("patternInfo")   = patternInfo,
+    Rcpp::Named("matrixProfile") = profileFrame
+  );
+}
@@ -0,0 +1,248 @@
+#include <vector>
+#include <string>
+#include <cmath>
+#include <numeric>
+#include <algorithm>
+#include <functional>
+#include "FastFind.hpp"
+
+/**
+ * @file saxIndex.cpp
+ * @brief Symbolic aggregate approximation (SAX) index over PIP windows of many series
+ *
+ * Every window of consecutive PIPs is z-normalized and each PIP becomes one symbol of
+ * an alphabet with equiprobable Gaussian bins. The word is packed into an integer key,
+ * and the index is the (key, series, position) table sorted by key. A query looks up
+ * the words of the reference shape (and of its neighbours up to a symbol tolerance)
+ * by binary search, and only these windows are verified with the fastFind detectors.
+ */
+
+// z-normalized window of the values first..first+length-1. Flat windows become all zero
+static std::vector<double> zNormalize(const NumericVector& values, int first, int length) {
+  std::vector<double> z(values.begin() + first, values.begin() + first + length);
+  double mean = std::accumulate(z.begin(), z.end(), 0.0) / length;
+  double variance = 0;
+  for (double v : z) {
+    variance += (v - mean) * (v - mean);
+  }
+  double sd = std::sqrt(variance / length);
+  for (double& v : z) {
+    v = sd > 0 ? (v - mean) / sd : 0;
+  }
+  return z;
+}
+
+// Breakpoints of alphabetSize equiprobable bins of the standard normal distribution
+static std::vector<double> saxBreakpoints(int alphabetSize) {
+  std::vector<double> breaks(alphabetSize - 1);
+  for (int k = 1; k < alphabetSize; ++k) {
+    breaks[k-1] = R::qnorm((double)k / alphabetSize, 0.0, 1.0, 1, 0);
+  }
+  return breaks;
+}
+
+static std::vector<int> saxWord(const std::vector<double>& z, const std::vector<double>& breaks) {
+  std::vector<int> word(z.size());
+  for (size_t k = 0; k < z.size(); ++k) {
+    word[k] = std::upper_bound(breaks.begin(), breaks.end(), z[k]) - breaks.begin();
+  }
+  return word;
+}
+
+static int saxKey(const std::vector<int>& word, int alphabetSize) {
+  int key = 0;
+  for (int symbol : word) {
+    key = key * alphabetSize + symbol;
+  }
+  return key;
+}
+
+//' @name buildSaxIndex
+//' @title buildSaxIndex
+//' @description Builds a SAX index over the PIP windows of many series, e.g. once per universe and stored with saveRDS. Every window of windowLength consecutive PIPs is z-normalized and turned into a word with one symbol per PIP.
+//' @param PrePro_indexFilters List with the PIP positions (zero based) of every series
+//' @param Original_prices List with the prices of every series
+//' @param windowLength PIPs per window, e.g. 6 for SHS or 4 for double tops
+//' @param alphabetSize Number of symbols
+//' @return Returns a list with windowLength, alphabetSize and words, a data.frame with key, series and position (first PIP of the window, one based) sorted by key
+//' @export
+// [[Rcpp::export]]
+Rcpp::List buildSaxIndex(Rcpp::List PrePro_indexFilters,
+                         Rcpp::List Original_prices,
+                         int windowLength = 6,
+                         int alphabetSize = 4
+){
+
+  if (PrePro_indexFilters.size() != Original_prices.size()) {
+    stop("PrePro_indexFilters and Original_prices need one element per series.");
+  }
+  if (alphabetSize < 2 || windowLength < 2 ||
+      windowLength * std::log((double)alphabetSize) >= 31 * std::log(2.0)) {
+    stop("alphabetSize^windowLength has to fit into an integer key.");
+  }
+
+  std::vector<double> breaks = saxBreakpoints(alphabetSize);
+  std::vector<int> key, series, position;
+
+  for (int s = 0; s < PrePro_indexFilters.size(); ++s) {
+    IntegerVector indexFilter = PrePro_indexFilters[s];
+    NumericVector prices      = Original_prices[s];
+    NumericVector pipPrices   = prices[indexFilter];
+
+    for (int i = 0; i + windowLength <= pipPrices.size(); ++i) {
+      key.push_back(saxKey(saxWord(zNormalize(pipPrices, i, windowLength), breaks), alphabetSize));
+      // R indices start at 1
+      series.push_back(s + 1);
+      position.push_back(i + 1);
+    }
+  }
+
+  std::vector<int> order(key.size());
+  std::iota(order.begin(), order.end(), 0);
+  std::stable_sort(order.begin(), order.end(), [&](int a, int b) { return key[a] < key[b]; });
+
+  IntegerVector sortedKey(order.size()), sortedSeries(order.size()), sortedPosition(order.size());
+  for (size_t k = 0; k < order.size(); ++k) {
+    sortedKey[k]      = key[order[k]];
+    sortedSeries[k]   = series[order[k]];
+    sortedPosition[k] = position[order[k]];
+  }
+
+  return Rcpp::List::create(
+    Rcpp::Named("windowLength") = windowLength,
+    Rcpp::Named("alphabetSize") = alphabetSize,
+    Rcpp::Named("words")        = Rcpp::DataFrame::create(Rcpp::Named("key")      = sortedKey,
+                                                          Rcpp::Named("series")   = sortedSeries,
+                                                          Rcpp::Named("position") = sortedPosition)
+  );
+}
+
+//' @name querySaxIndex
+//' @title querySaxIndex
+//' @description Finds windows shaped like the reference shape in an index of buildSaxIndex. The words of the shape and of its neighbours (every symbol off by at most symbolTolerance) are looked up by binary search. The windows found are verified exactly with the fastFind detector of patternName; only these series are loaded into the detector.
+//' @param index Index from buildSaxIndex
+//' @param shape Prices of the reference shape, windowLength values
+//' @param patternName fastFind pattern the windows are verified with, e.g. SHS, iSHS, DTOP, DBOT, TTOP or TBOT
+//' @param PrePro_indexFilters List with the PIP positions (zero based) of every series, as for the index
+//' @param Original_times List with the times of every series
+//' @param Original_prices List with the prices of every series
+//' @param symbolTolerance Maximum difference per symbol between the shape's word and a window's word
+//' @param peakTolerance As in fastFind
+//' @param lineTolerance As in fastFind
+//' @return Returns a data.frame with one row per verified window, closest first: series, startIdx (first PIP, one based), breakoutIdx (in the original series, one based, NA without breakout) and the Euclidean distance between the z-normalized shape and window
+//' @export
+// [[Rcpp::export]]
+Rcpp::DataFrame querySaxIndex(Rcpp::List index,
+                              NumericVector shape,
+                              std::string patternName,
+                              Rcpp::List PrePro_indexFilters,
+                              Rcpp::List Original_times,
+                              Rcpp::List Original_prices,
+                              int symbolTolerance = 0,
+                              double peakTolerance = 0.015,
+                              double lineTolerance = 0.02
+){
+
+  int windowLength = index["windowLength"];
+  int alphabetSize = index["alphabetSize"];
+  Rcpp::DataFrame words = index["words"];
+  IntegerVector key      = words["key"];
+  IntegerVector series   = words["series"];
+  IntegerVector position = words["position"];
+  if (shape.size() != windowLength) {
+    stop("shape needs windowLength values.");
+  }
+  if (!createDetector(patternName, peakTolerance, lineTolerance)) {
+    stop("Unknown patternName.");
+  }
+
+  std::vector<double> query = zNormalize(shape, 0, windowLength);
+  std::vector<int> word = saxWord(query, saxBreakpoints(alphabetSize));
+
+  // Words within the symbol tolerance, enumerated symbol by symbol
+  std::vector<int> keys;
+  std::vector<int> neighbour(windowLength);
+  std::function<void(int)> enumerate = [&](int k) {
+    if (k == windowLength) {
+      keys.push_back(saxKey(neighbour, alphabetSize));
+      return;
+    }
+    for (int symbol = std::max(0, word[k] - symbolTolerance);
+         symbol <= std::min(alphabetSize - 1, word[k] + symbolTolerance); ++symbol) {
+      neighbour[k] = symbol;
+      enumerate(k + 1);
+    }
+  };
+  enumerate(0);
+
+  // Candidate windows as (series, position), zero based
+  std::vector<std::pair<int, int>> candidates;
+  for (int k : keys) {
+    auto range = std::equal_range(key.begin(), key.end(), k);
+    for (auto it = range.first; it != range.second; ++it) {
+      int row = it - key.begin();
+      candidates.push_back({series[row] - 1, position[row] - 1});
+    }
+  }
+  std::sort(candidates.begin(), candidates.end());
+
+  std::vector<int> resultSeries, startIdx, breakoutIdx;
+  std::vector<double> distance;
+
+  // Verification series by series, each detector is prepared once per series
+  for (size_t c = 0; c < candidates.size(); ) {
+    int s = candidates[c].first;
+    IntegerVector indexFilter = PrePro_indexFilters[s];
+    NumericVector times       = Original_times[s];
+    NumericVector prices      = Original_prices[s];
+    NumericVector pipTimes    = times[indexFilter];
+    NumericVector pipPrices   = prices[indexFilter];
+    SeriesData data = {indexFilter, times, prices, pipTimes, pipPrices};
+
+    std::unique_ptr<PatternDetector> detector = createDetector(patternName, peakTolerance, lineTolerance);
+    detector->prepare(data);
+
+    PipWindow window;
+    for (; c < candidates.size() && candidates[c].first == s; ++c) {
+      int i = candidates[c].second;
+      loadWindow(data, i, window);
+      PatternData pattern;
+      if (window.size < detector->windowLength() ||
+          !detector->detect(data, window, pattern) || pattern.patternName != patternName) {
+        continue;
+      }
+      bool breakout = findBreakout(*detector, data, pattern);
+
+      std::vector<double> z = zNormalize(pipPrices, i, windowLength);
+      double squares = 0;
+      for (int k = 0; k < windowLength; ++k) {
+        squares += (z[k] - query[k]) * (z[k] - query[k]);
+      }
+      // R indices start at 1
+      resultSeries.push_back(s + 1);
+      startIdx.push_back(i + 1);
+      breakoutIdx.push_back(breakout ? pattern.breakoutIdx + 1 : NA_INTEGER);
+      distance.push_back(std::sqrt(squares));
+    }
+  }
+
+  // Closest windows first
+  std::vector<int> order(distance.size());
+  std::iota(order.begin(), order.end(), 0);
+  std::stable_sort(order.begin(), order.end(), [&](int a, int b) { return distance[a] < distance[b]; });
+
+  IntegerVector outSeries(order.size()), outStart(order.size()), outBreakout(order.size());
+  NumericVector outDistance(order.size());
+  for (size_t k = 0; k < order.size(); ++k) {
+    outSeries[k]   = resultSeries[order[k]];
+    outStart[k]    = startIdx[order[k]];
+    outBreakout[k] = breakoutIdx[order[k]];
+    outDistance[k] = distance[order[k]];
+  }
+
+  return Rcpp::DataFrame::create(Rcpp::Named("series")      = outSeries,
+                                 Rcpp::Named("startIdx")    = outStart,
+                                 Rcpp::Named("breakoutIdx") = outBreakout,
+                                 Rcpp::Named("distance")    = outDistance
+  );
+}
@@ -0,0 +1,156 @@
+#include <vector>
+#include <cmath>
+#include <algorithm>
+#include "cppHeader.hpp"
+
+// Bits of the candlestick predicates
+enum CandleBit {
+  DOJI                 = 0,
+  HAMMER               = 1,
+  SHOOTING_STAR        = 2,
+  BULLISH_ENGULFING    = 3,
+  BEARISH_ENGULFING    = 4,
+  MORNING_STAR         = 5,
+  EVENING_STAR         = 6,
+  THREE_WHITE_SOLDIERS = 7,
+  THREE_BLACK_CROWS    = 8
+};
+
+// Body of a doji at most this part of the bar's range
+const double DOJI_BODY = 0.1;
+// Hammer / shooting star: long shadow at least this many bodies, short shadow at most this part of the range
+const double LONG_SHADOW  = 2.0;
+const double SHORT_SHADOW = 0.1;
+// Star patterns: first bar's body at least this part of its range, star body at most this part of the first body
+const double LONG_BODY = 0.5;
+const double STAR_BODY = 0.3;
+
+// All predicates of bar k as bits. Bars before the series start are clamped to k and
+// masked out afterwards, so the function has no branches and the scan loop vectorizes
+#pragma omp declare simd uniform(open, high, low, close) linear(k:1) notinbranch
+inline int candleBits(const double* open, const double* high, const double* low,
+                      const double* close, int k) {
+  int k1 = std::max(k - 1, 0);
+  int k2 = std::max(k - 2, 0);
+  bool has1 = k >= 1;
+  bool has2 = k >= 2;
+  
+  double o = open[k],  h = high[k], l = low[k], c = close[k];
+  double o1 = open[k1], c1 = close[k1];
+  double o2 = open[k2], c2 = close[k2], range2 = high[k2] - low[k2];
+  
+  double body  = std::fabs(c - o);
+  double range = h - l;
+  double upper = h - std::max(o, c);
+  double lower = std::min(o, c) - l;
+  
+  bool doji         = (range > 0) & (body <= DOJI_BODY * range);
+  bool hammer       = (range > 0) & (lower >= LONG_SHADOW * body) & (upper <= SHORT_SHADOW * range);
+  bool shootingStar = (range > 0) & (upper >= LONG_SHADOW * body) & (lower <= SHORT_SHADOW * range);
+  
+  bool bullEngulf = has1 & (c1 < o1) & (c > o) & (o <= c1) & (c >= o1);
+  bool bearEngulf = has1 & (c1 > o1) & (c < o) & (o >= c1) & (c <= o1);
+  
+  // Long first bar, small star, third bar closes beyond the middle of the first
+  bool starBody     = std::fabs(c1 - o1) <= STAR_BODY * std::fabs(c2 - o2);
+  bool morningStar  = has2 & ((o2 - c2) >= LONG_BODY * range2) & starBody & (c > o) & (c > (o2 + c2) / 2);
+  bool eveningStar  = has2 & ((c2 - o2) >= LONG_BODY * range2) & starBody & (c < o) & (c < (o2 + c2) / 2);
+  
+  // Three rising (falling) closes, each bar opening within the body before
+  bool soldiers = has2 & (c2 > o2) & (c1 > o1) & (c > o) & (c1 > c2) & (c > c1) &
+                  (o1 >= o2) & (o1 <= c2) & (o >= o1) & (o <= c1);
+  bool crows    = has2 & (c2 < o2) & (c1 < o1) & (c < o) & (c1 < c2) & (c < c1) &
+                  (o1 <= o2) & (o1 >= c2) & (o <= o1) & (o >= c1);
+  
+  return ((int)doji         << DOJI) |
+         ((int)hammer       << HAMMER) |
+         ((int)shootingStar << SHOOTING_STAR) |
+         ((int)bullEngulf   << BULLISH_ENGULFING) |
+         ((int)bearEngulf   << BEARISH_ENGULFING) |
+         ((int)morningStar  << MORNING_STAR) |
+         ((int)eveningStar  << EVENING_STAR) |
+         ((int)soldiers     << THREE_WHITE_SOLDIERS) |
+         ((int)crows        << THREE_BLACK_CROWS);
+}
+
+//' @name scanCandles
+//' @title scanCandles
+//' @description Evaluates candlestick predicates over OHLC bars in one vectorized pass. Every bar gets a bitset: bit 0 doji, 1 hammer, 2 shooting star, 3 bullish engulfing, 4 bearish engulfing, 5 morning star, 6 evening star, 7 three white soldiers, 8 three black crows. Multi-bar patterns are flagged on their last bar.
+//' @param open Opening prices
+//' @param high Highs
+//' @param low Lows
+//' @param close Closing prices
+//' @param mask Bits of the predicates to report, all (511) by default
+//' @return Returns an integer vector with the bitset of every bar
+//' @export
+// [[Rcpp::export]]
+IntegerVector scanCandles(NumericVector open,
+                          NumericVector high,
+                          NumericVector low,
+                          NumericVector close,
+                          int mask = 511
+){
+  
+  int n = close.size();
+  if (open.size() != n || high.size() != n || low.size() != n) {
+    Rcpp::stop("open, high, low and close need the same length.");
+  }
+  
+  IntegerVector bits(n);
+  const double* o = open.begin();
+  const double* h = high.begin();
+  const double* l = low.begin();
+  const double* c = close.begin();
+  int* out = bits.begin();
+  
+#pragma omp simd
+  for (int k = 0; k < n; ++k) {
+    out[k] = candleBits(o, h, l, c, k) & mask;
+  }
+  
+  return bits;
+}
+
+//' @name confirmBreakouts
+//' @title confirmBreakouts
+//' @description Uses the bitsets of scanCandles as confirmation filter for pattern breakouts, e.g. SHS/iSHS from fastFind: a breakout is confirmed if one of the lookback bars up to the breakout has a candlestick pattern in the direction of the breakout.
+//' @param candles Bitsets from scanCandles
+//' @param breakoutIdx Breakout indices (one based, as returned by fastFind)
+//' @param bearish TRUE for breakouts downwards (SHS), FALSE for breakouts upwards (iSHS), one value per breakout
+//' @param bullishMask Candlestick bits confirming upward breakouts, by default hammer, bullish engulfing, morning star and three white soldiers
+//' @param bearishMask Candlestick bits confirming downward breakouts, by default shooting star, bearish engulfing, evening star and three black crows
+//' @param lookback Number of bars up to and including the breakout bar that are checked
+//' @return Returns a logical vector, TRUE for confirmed breakouts, NA for missing or out of range breakouts and NA directions
+//' @export
+// [[Rcpp::export]]
+LogicalVector confirmBreakouts(IntegerVector candles,
+                               IntegerVector breakoutIdx,
+                               LogicalVector bearish,
+                               int bullishMask = 170,
+                               int bearishMask = 340,
+                               int lookback = 3
+){
+  
+  int n = breakoutIdx.size();
+  if (bearish.size() != n) {
+    Rcpp::stop("bearish needs one value per breakout.");
+  }
+  LogicalVector confirmed(n);
+  
+  for (int b = 0; b < n; ++b) {
+    // R indices start at 1
+    int last = breakoutIdx[b] - 1;
+    if (breakoutIdx[b] == NA_INTEGER || bearish[b] == NA_LOGICAL || last < 0 || last >= candles.size()) {
+      confirmed[b] = NA_LOGICAL;
+      continue;
+    }
+    int mask = bearish[b] ? bearishMask : bullishMask;
+    int hits = 0;
+    for (int k = std::max(0, last - lookback + 1); k <= last; ++k) {
+      hits |= candles[k] & mask;
+    }
+    confirmed[b] = hits != 0;
+  }
+  
+  return confirmed;
+}
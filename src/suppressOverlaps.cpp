@@ -0,0 +1,76 @@
+#include <vector>
+#include <string>
+#include <map>
+#include <cmath>
+#include <numeric>
+#include <iterator>
+#include <algorithm>
+#include "FastFind.hpp"
+
+/**
+ * @file suppressOverlaps.cpp
+ * @brief Non-maximum suppression of overlapping pattern instances
+ *
+ * Candidates are visited by decreasing score. A candidate is kept unless its span
+ * overlaps a kept span of the same pattern. The kept spans of a pattern never overlap
+ * each other, so they are ordered by start and end alike and only the kept span
+ * starting last before the candidate's end can overlap it: one lookup in an ordered
+ * map. The whole stage is O(k log k) for k candidates.
+ */
+
+std::vector<bool> overlapWinners(const std::vector<std::string>& names, const std::vector<double>& starts,
+                                 const std::vector<double>& ends, const std::vector<double>& scores) {
+  int k = names.size();
+  std::vector<int> order(k);
+  std::iota(order.begin(), order.end(), 0);
+  // Best first, NaN scores last, ties go to the earlier span
+  auto score = [&](int i) { return std::isnan(scores[i]) ? -HUGE_VAL : scores[i]; };
+  std::stable_sort(order.begin(), order.end(), [&](int a, int b) {
+    return score(a) > score(b) || (score(a) == score(b) && starts[a] < starts[b]);
+  });
+
+  // Kept spans per pattern, start -> end
+  std::map<std::string, std::map<double, double>> kept;
+  std::vector<bool> keep(k, false);
+  for (int i : order) {
+    std::map<double, double>& spans = kept[names[i]];
+    // Spans that only touch do not overlap
+    auto next = spans.lower_bound(ends[i]);
+    if (next != spans.begin() && std::prev(next)->second > starts[i]) {
+      continue;
+    }
+    spans.emplace(starts[i], ends[i]);
+    keep[i] = true;
+  }
+  return keep;
+}
+
+//' @name suppressOverlaps
+//' @title suppressOverlaps
+//' @description Non-maximum suppression of pattern instances, e.g. of the same formation reported from shifted windows or the rows of fastFind_chaosRegin. Per pattern name the best scoring instance among overlapping spans is kept, then the next best one that overlaps none of the kept ones, and so on. Spans that only touch do not overlap. Sort plus sweep in O(k log k).
+//' @param PatternName Pattern name of every instance, only instances of the same name suppress each other
+//' @param spanStart Start of every instance, e.g. timeStamp0
+//' @param spanEnd End of every instance, e.g. the time stamp of its last pattern point
+//' @param score Optional score of every instance, higher is better (e.g. confidence). Without scores the earlier instance wins
+//' @return Returns a logical vector, TRUE for the instances kept
+//' @export
+// [[Rcpp::export]]
+LogicalVector suppressOverlaps(std::vector<std::string> PatternName,
+                               std::vector<double> spanStart,
+                               std::vector<double> spanEnd,
+                               Rcpp::Nullable<NumericVector> score = R_NilValue
+){
+
+  int k = PatternName.size();
+  std::vector<double> scores(k, 0.0);
+  if (score.isNotNull()) {
+    NumericVector values(score.get());
+    scores.assign(values.begin(), values.end());
+  }
+  if ((int)spanStart.size() != k || (int)spanEnd.size() != k || (int)scores.size() != k) {
+    stop("PatternName, spanStart, spanEnd and score need the same length.");
+  }
+
+  std::vector<bool> keep = overlapWinners(PatternName, spanStart, spanEnd, scores);
+  return LogicalVector(keep.begin(), keep.end());
+}
@@ -0,0 +1,109 @@
+#include <vector>
+#include <cmath>
+#include <algorithm>
+#include "cppHeader.hpp"
+#include "RangeExtremum.hpp"
+#include "Volatility.hpp"
+
+/**
+ * @file tripleBarrier.cpp
+ * @brief Triple-barrier labels of events, e.g. pattern breakouts
+ *
+ * From the entry price of every event an upper and a lower barrier are set, and a
+ * vertical barrier after maxHolding bars. The first crossing of each price barrier is
+ * found in O(log n) on a range-extremum index of the prices instead of scanning bar by
+ * bar. The index is built once and only read afterwards, so the events are labelled
+ * on OpenMP threads.
+ */
+
+//' @name tripleBarrier
+//' @title tripleBarrier
+//' @description Labels events by the first of three barriers they hit: the upper barrier (label 1), the lower barrier (label -1) or, if none is crossed within maxHolding bars, the vertical barrier (label 0). Barrier widths are relative to the entry price or, with volatilityWindow > 0, multiples of the standard deviation of the price changes over the volatilityWindow bars up to the event. Multithreaded across events with OpenMP.
+//' @param Original_prices Vector with prices
+//' @param eventIdx Event indices (one based, e.g. breakoutIdx of fastFind), the entry is the price at the event
+//' @param upper Width of the upper barrier
+//' @param lower Width of the lower barrier
+//' @param maxHolding Number of bars after the event until the vertical barrier
+//' @param volatilityWindow 0 for barrier widths relative to the entry price, otherwise the number of bars of the volatility the widths are scaled with
+//' @param bearish Optional, TRUE for short events (e.g. SHS breakouts). Their labels and returns are negated, so the lower barrier is the profit target
+//' @return Returns a data.frame with one row per event: label, exitIdx (one based, the bar that hit the barrier), holding (bars from the event to the exit), return (relative price change from the entry to the exit), and the upperBarrier and lowerBarrier prices. NA for events outside the series, events without a volatility at the event and events that reach the end of the series before any barrier
+//' @export
+// [[Rcpp::export]]
+Rcpp::DataFrame tripleBarrier(NumericVector Original_prices,
+                              IntegerVector eventIdx,
+                              double upper = 0.02,
+                              double lower = 0.02,
+                              int maxHolding = 20,
+                              int volatilityWindow = 0,
+                              Rcpp::Nullable<LogicalVector> bearish = R_NilValue
+){
+
+  int n = Original_prices.size();
+  int events = eventIdx.size();
+  if (maxHolding < 1 || upper <= 0 || lower <= 0) {
+    stop("upper, lower and maxHolding have to be positive.");
+  }
+  std::vector<int> side(events, 1);
+  if (bearish.isNotNull()) {
+    LogicalVector isBearish(bearish.get());
+    if (isBearish.size() != events) {
+      stop("bearish needs one value per event.");
+    }
+    for (int e = 0; e < events; ++e) {
+      side[e] = isBearish[e] == TRUE ? -1 : 1;
+    }
+  }
+
+  // Plain copies and read-only indexes, the threads must not touch R objects
+  std::vector<double> prices(Original_prices.begin(), Original_prices.end());
+  std::vector<int> event(eventIdx.begin(), eventIdx.end());
+  RangeExtremum index(prices);
+  RollingVolatility volatility(prices);
+
+  std::vector<int> label(events, NA_INTEGER), exitIdx(events, NA_INTEGER), holding(events, NA_INTEGER);
+  std::vector<double> realized(events, NA_REAL), upperBarrier(events, NA_REAL), lowerBarrier(events, NA_REAL);
+
+#pragma omp parallel for schedule(static)
+  for (int e = 0; e < events; ++e) {
+    // R indices start at 1
+    int i = event[e] - 1;
+    if (event[e] == NA_INTEGER || i < 0 || i >= n) {
+      continue;
+    }
+    double entry = prices[i];
+    double scale = volatilityWindow > 0 ? volatility.at(i, volatilityWindow) : std::fabs(entry);
+    // Without a volatility (first bar, flat stretch) every tick would hit a barrier
+    if (!(scale > 0) || !std::isfinite(scale)) {
+      continue;
+    }
+    double high = entry + upper * scale;
+    double low  = entry - lower * scale;
+    int last = std::min(i + maxHolding, n - 1);
+
+    // First crossings after the event, -1 or beyond the vertical barrier if there is none
+    int hitUpper = i + 1 < n ? index.firstAbove(i + 1, high) : -1;
+    int hitLower = i + 1 < n ? index.firstBelow(i + 1, low)  : -1;
+    bool upperFirst = hitUpper >= 0 && hitUpper <= last && (hitLower < 0 || hitUpper < hitLower);
+    bool lowerFirst = hitLower >= 0 && hitLower <= last && !upperFirst;
+    // The series ends before the vertical barrier: the event did not time out
+    if (!upperFirst && !lowerFirst && i + maxHolding > n - 1) {
+      continue;
+    }
+
+    int exit = upperFirst ? hitUpper : lowerFirst ? hitLower : last;
+    label[e]        = side[e] * (upperFirst ? 1 : lowerFirst ? -1 : 0);
+    exitIdx[e]      = exit + 1;
+    holding[e]      = exit - i;
+    realized[e]     = side[e] * (prices[exit] - entry) / entry;
+    upperBarrier[e] = high;
+    lowerBarrier[e] = low;
+  }
+
+  return Rcpp::DataFrame::create(Rcpp::Named("label")        = label,
+                                 Rcpp::Named("exitIdx")      = exitIdx,
+                                 Rcpp::Named("holding")      = holding,
+                                 Rcpp::Named("return")       = realized,
+                                 Rcpp::Named("upperBarrier") = upperBarrier,
+                                 Rcpp::Named("lowerBarrier") = lowerBarrier
+  );
+}